@@ -0,0 +1,176 @@
+﻿using System;
+using System.Collections.Generic;
+using System.IO;
+using System.Linq;
+using System.Reflection;
+using System.Text;
+
+namespace ExportIndexBuilder
+{
+    // Scans managed assemblies for [NativeExport] methods and writes the binary export index that the native host
+    // memory-maps (ExportIndex in export_index.h). Layout, little endian:
+    //   header (16 bytes): "MXIX", version, entry count, string table offset
+    //   entries (32 bytes each, sorted by id): id, assembly, type and method string offsets, padding, signature hash
+    //   string table: NUL-terminated UTF-8 strings, offsets are relative to the start of the table
+    class Program
+    {
+        private const uint IndexVersion = 1;
+        private const int HeaderSize = 16;
+        private const int EntrySize = 32;
+        private const ulong FnvOffsetBasis = 14695981039346656037;
+        private const ulong FnvPrime = 1099511628211;
+
+        private class Export
+        {
+            public int Id;
+            public string AssemblyName;
+            public string TypeName;
+            public string MethodName;
+            public string Signature;
+        }
+
+        static int Main(string[] args)
+        {
+            if (args.Length < 2)
+            {
+                Console.Error.WriteLine("Usage: ExportIndexBuilder <index_path> <assembly_path> [assembly_path...]");
+                return -1;
+            }
+
+            var exports = new List<Export>();
+            foreach (var assemblyPath in args.Skip(1))
+                exports.AddRange(ScanAssembly(Path.GetFullPath(assemblyPath)));
+
+            // Binding fails at build time instead of at run time when two methods claim the same id
+            var duplicates = exports.GroupBy(e => e.Id).Where(g => g.Count() > 1).ToList();
+            foreach (var duplicate in duplicates)
+                Console.Error.WriteLine($"ERROR: Native export id {duplicate.Key} is used by {string.Join(", ", duplicate.Select(e => e.TypeName + "." + e.MethodName))}");
+            if (duplicates.Count > 0)
+                return -1;
+
+            exports.Sort((left, right) => left.Id.CompareTo(right.Id));
+            WriteIndex(args[0], exports);
+            foreach (var export in exports)
+                Console.WriteLine($"{export.Id,6} {export.AssemblyName} {export.TypeName}.{export.MethodName} {export.Signature}");
+            Console.WriteLine($"Export index {args[0]}: {exports.Count} methods");
+            return 0;
+        }
+
+        private static IEnumerable<Export> ScanAssembly(string assemblyPath)
+        {
+            var assembly = Assembly.LoadFrom(assemblyPath);
+            var assemblyName = assembly.GetName();
+            Type[] types;
+            try
+            {
+                types = assembly.GetTypes();
+            }
+            catch (ReflectionTypeLoadException exception)
+            {
+                types = exception.Types.Where(t => t != null).ToArray();
+            }
+
+            foreach (var type in types.Where(t => t.IsPublic || t.IsNestedPublic))
+            {
+                foreach (var method in type.GetMethods(BindingFlags.Public | BindingFlags.Static | BindingFlags.DeclaredOnly))
+                {
+                    // Matched by name so plugin assemblies can declare their own attribute
+                    var attribute = method.CustomAttributes.FirstOrDefault(a => a.AttributeType.Name == "NativeExportAttribute");
+                    if (attribute == null)
+                        continue;
+                    yield return new Export
+                    {
+                        Id = (int)attribute.ConstructorArguments[0].Value,
+                        AssemblyName = $"{assemblyName.Name}, Version={assemblyName.Version}",
+                        TypeName = type.FullName,
+                        MethodName = method.Name,
+                        Signature = GetSignature(method)
+                    };
+                }
+            }
+        }
+
+        // Native view of the signature, e.g. "str(str,i32,i32,f64[],fn)". The host hashes the signature it expects
+        // with the same function and compares it with the index.
+        private static string GetSignature(MethodInfo method)
+        {
+            var parameters = method.GetParameters().Select(p => GetTypeToken(p.ParameterType));
+            return $"{GetTypeToken(method.ReturnType)}({string.Join(",", parameters)})";
+        }
+
+        private static string GetTypeToken(Type type)
+        {
+            if (type.IsArray)
+                return GetTypeToken(type.GetElementType()) + "[]";
+            if (type.IsPointer || type == typeof(IntPtr) || type == typeof(UIntPtr))
+                return "ptr";
+            if (typeof(Delegate).IsAssignableFrom(type))
+                return "fn";
+            if (type == typeof(void))
+                return "void";
+            if (type == typeof(bool))
+                return "bool";
+            if (type == typeof(byte))
+                return "u8";
+            if (type == typeof(int))
+                return "i32";
+            if (type == typeof(long))
+                return "i64";
+            if (type == typeof(float))
+                return "f32";
+            if (type == typeof(double))
+                return "f64";
+            if (type == typeof(string))
+                return "str";
+            return type.FullName;
+        }
+
+        // FNV-1a 64-bit, must match ExportIndex::HashSignature
+        private static ulong HashSignature(string signature)
+        {
+            ulong hash = FnvOffsetBasis;
+            foreach (var value in Encoding.UTF8.GetBytes(signature))
+            {
+                hash ^= value;
+                hash *= FnvPrime;
+            }
+            return hash;
+        }
+
+        private static void WriteIndex(string indexPath, List<Export> exports)
+        {
+            var strings = new MemoryStream();
+            var stringOffsets = new Dictionary<string, uint>();
+            uint AddString(string value)
+            {
+                if (stringOffsets.TryGetValue(value, out var offset))
+                    return offset;
+                offset = (uint)strings.Length;
+                var bytes = Encoding.UTF8.GetBytes(value);
+                strings.Write(bytes, 0, bytes.Length);
+                strings.WriteByte(0);
+                stringOffsets[value] = offset;
+                return offset;
+            }
+
+            using (var writer = new BinaryWriter(File.Create(indexPath)))
+            {
+                writer.Write(Encoding.ASCII.GetBytes("MXIX"));
+                writer.Write(IndexVersion);
+                writer.Write((uint)exports.Count);
+                writer.Write((uint)(HeaderSize + exports.Count * EntrySize));
+                foreach (var export in exports)
+                {
+                    writer.Write((uint)export.Id);
+                    writer.Write(AddString(export.AssemblyName));
+                    writer.Write(AddString(export.TypeName));
+                    writer.Write(AddString(export.MethodName));
+                    writer.Write((uint)0);
+                    writer.Write((uint)0);
+                    writer.Write(HashSignature(export.Signature));
+                }
+                writer.Write(strings.ToArray());
+            }
+        }
+    }
+}
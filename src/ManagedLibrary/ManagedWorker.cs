@@ -1,6 +1,9 @@
 ﻿using System;
+using System.Collections.Generic;
+using System.Diagnostics;
 using System.Linq;
 using System.Runtime.InteropServices;
+using System.Text;
 using System.Threading;
 
 namespace ManagedLibraryNamespace
@@ -20,9 +23,41 @@ namespace ManagedLibraryNamespace
 
         public delegate int ReportProgressFunction(int progress);
 
+        // Must match CallStatus in interop_cancellation.h
+        public enum CallStatus
+        {
+            Running = 0,
+            Completed = 1,
+            Cancelled = 2,
+            DeadlineExceeded = 3
+        }
+
+        // Native memory shared with the caller (layout must match CallControlBlock in interop_cancellation.h).
+        // The native side sets CancelRequested while the call runs; polling it is a plain memory read, no transition.
+        [StructLayout(LayoutKind.Sequential)]
+        public struct CallControlBlock
+        {
+            public int CancelRequested;
+            public int Status;
+            public long TimeoutMilliseconds;
+        }
+
+        // Reading the clock costs more than reading the flag, so tight loops only check the deadline every few polls
+        private const long DeadlinePollMask = 1023;
+        private const int PollSliceMilliseconds = 1;
+
+        // Job names registered by native code (see InternedStringTable in interned_strings.h), indexed by handle.
+        // Writers take JobNamesLock; readers only read the published count and array, in that order.
+        private const int InvalidJobNameHandle = -1;
+        private static readonly object JobNamesLock = new object();
+        private static readonly Dictionary<string, int> JobNameHandles = new Dictionary<string, int>();
+        private static string[] _jobNames = new string[16];
+        private static int _jobNameCount;
+
         // This test method doesn't actually do anything, it just takes some input parameters,
         // waits (in a loop) for a bit, invoking the callback function periodically, and
         // then returns a string version of the double[] passed in.
+        [NativeExport(3)]
         [return: MarshalAs(UnmanagedType.LPStr)]
         public static string DoWork(
             [MarshalAs(UnmanagedType.LPStr)] string jobName,
@@ -31,6 +66,152 @@ namespace ManagedLibraryNamespace
             [MarshalAs(UnmanagedType.LPArray, SizeParamIndex = 2)] double[] data,
             ReportProgressFunction reportProgressFunction)
         {
+            unsafe
+            {
+                return RunWork(iterations, data, reportProgressFunction, null);
+            }
+        }
+
+        // Same as DoWork, but returns promptly (with null) once the caller cancels the call or its deadline expires.
+        // The outcome is written to the control block status.
+        [NativeExport(4)]
+        [return: MarshalAs(UnmanagedType.LPStr)]
+        public static unsafe string DoWorkCancellable(
+            [MarshalAs(UnmanagedType.LPStr)] string jobName,
+            int iterations,
+            int dataSize,
+            [MarshalAs(UnmanagedType.LPArray, SizeParamIndex = 2)] double[] data,
+            ReportProgressFunction reportProgressFunction,
+            IntPtr controlBlock)
+        {
+            return RunWork(iterations, data, reportProgressFunction, (CallControlBlock*)controlBlock);
+        }
+
+        // Same as DoWork, but the job name is passed as UTF-8 bytes and a length instead of being marshalled,
+        // so no managed string is allocated for it. As in DoWork, the work does not read the name, so the bytes are
+        // only validated; JobNameHashUtf8 shows reading them in place through a ReadOnlySpan<byte>.
+        [NativeExport(6)]
+        [return: MarshalAs(UnmanagedType.LPStr)]
+        public static unsafe string DoWorkUtf8(
+            byte* jobName,
+            int jobNameLength,
+            int iterations,
+            int dataSize,
+            [MarshalAs(UnmanagedType.LPArray, SizeParamIndex = 3)] double[] data,
+            ReportProgressFunction reportProgressFunction)
+        {
+            if (jobName == null || jobNameLength < 0)
+                return null;
+            return RunWork(iterations, data, reportProgressFunction, null);
+        }
+
+        // Adds a UTF-8 job name to the interning table and returns its handle (the existing handle if already registered)
+        [NativeExport(7)]
+        public static unsafe int RegisterJobName(byte* name, int length)
+        {
+            if (name == null || length < 0)
+                return InvalidJobNameHandle;
+            var jobName = Encoding.UTF8.GetString(name, length);
+            lock (JobNamesLock)
+            {
+                if (JobNameHandles.TryGetValue(jobName, out int handle))
+                    return handle;
+                handle = _jobNameCount;
+                var jobNames = _jobNames;
+                if (handle == jobNames.Length)
+                {
+                    Array.Resize(ref jobNames, jobNames.Length * 2);
+                    Volatile.Write(ref _jobNames, jobNames);
+                }
+                jobNames[handle] = jobName;
+                JobNameHandles.Add(jobName, handle);
+                Volatile.Write(ref _jobNameCount, handle + 1);
+                return handle;
+            }
+        }
+
+        // Same as DoWork, but the job name is a handle returned by RegisterJobName. Returns null for an unknown handle.
+        [NativeExport(8)]
+        [return: MarshalAs(UnmanagedType.LPStr)]
+        public static unsafe string DoWorkInterned(
+            int jobNameHandle,
+            int iterations,
+            int dataSize,
+            [MarshalAs(UnmanagedType.LPArray, SizeParamIndex = 2)] double[] data,
+            ReportProgressFunction reportProgressFunction)
+        {
+            if (GetJobName(jobNameHandle) == null)
+                return null;
+            return RunWork(iterations, data, reportProgressFunction, null);
+        }
+
+        // The JobNameHash methods do a small amount of work on the job name so the string benchmark measures the cost
+        // of each way of passing it. For ASCII names all three return the same hash.
+        [NativeExport(9)]
+        public static long JobNameHash([MarshalAs(UnmanagedType.LPStr)] string jobName)
+        {
+            return HashJobName(jobName.AsSpan());
+        }
+
+        [NativeExport(10)]
+        public static unsafe long JobNameHashUtf8(byte* jobName, int jobNameLength)
+        {
+            if (jobName == null || jobNameLength < 0)
+                return 0;
+            var name = new ReadOnlySpan<byte>(jobName, jobNameLength);
+            ulong hash = FnvOffsetBasis;
+            for (int i = 0; i < name.Length; i++)
+                hash = (hash ^ name[i]) * FnvPrime;
+            return (long)hash;
+        }
+
+        [NativeExport(11)]
+        public static long JobNameHashInterned(int jobNameHandle)
+        {
+            var jobName = GetJobName(jobNameHandle);
+            return jobName == null ? 0 : HashJobName(jobName.AsSpan());
+        }
+
+        // Bytes allocated by the managed heap on the calling thread, used to measure what each call allocates
+        [NativeExport(12)]
+        public static long GetAllocatedBytes()
+        {
+            return GC.GetAllocatedBytesForCurrentThread();
+        }
+
+        // Tight compute loop used to measure the cost of polling the control block and the cancellation latency.
+        // controlBlock may be zero to run without polling.
+        [NativeExport(5)]
+        [return: MarshalAs(UnmanagedType.R8)]
+        public static unsafe double SpinWork(long iterations, IntPtr controlBlock)
+        {
+            var control = (CallControlBlock*)controlBlock;
+            long deadline = GetDeadlineTimestamp(control);
+            double accumulator = 0;
+            for (long i = 0; i < iterations; i++)
+            {
+                accumulator += Math.Sqrt(i);
+                if (control == null)
+                    continue;
+                var status = PollCancellation(control, deadline, (i & DeadlinePollMask) == 0);
+                if (status != CallStatus.Running)
+                {
+                    control->Status = (int)status;
+                    return accumulator;
+                }
+            }
+            if (control != null)
+                control->Status = (int)CallStatus.Completed;
+            return accumulator;
+        }
+
+        private static unsafe string RunWork(
+            int iterations,
+            double[] data,
+            ReportProgressFunction reportProgressFunction,
+            CallControlBlock* control)
+        {
+            long deadline = GetDeadlineTimestamp(control);
             for (int i = 1; i <= iterations; i++)
             {
                 Console.ForegroundColor = ConsoleColor.Cyan;
@@ -38,7 +219,15 @@ namespace ManagedLibraryNamespace
                 Console.ResetColor();
 
                 // Pause as if doing work
-                Thread.Sleep(1000);
+                var status = Pause(1000, control, deadline);
+                if (status != CallStatus.Running)
+                {
+                    Console.ForegroundColor = ConsoleColor.Yellow;
+                    Console.WriteLine($"Work stopped: {status}");
+                    Console.ResetColor();
+                    control->Status = (int)status;
+                    return null;
+                }
 
                 // Call the native callback and write its return value to the console
                 var progressResponse = reportProgressFunction(i);
@@ -49,15 +238,74 @@ namespace ManagedLibraryNamespace
             Console.WriteLine($"Work completed");
             Console.ResetColor();
 
+            if (control != null)
+                control->Status = (int)CallStatus.Completed;
             return $"Data received: {string.Join(", ", data.Select(d => d.ToString()))}";
         }
 
+        // Sleeps in short slices so a cancellation is observed within about PollSliceMilliseconds
+        private static unsafe CallStatus Pause(int milliseconds, CallControlBlock* control, long deadline)
+        {
+            if (control == null)
+            {
+                Thread.Sleep(milliseconds);
+                return CallStatus.Running;
+            }
+            long end = Stopwatch.GetTimestamp() + milliseconds * Stopwatch.Frequency / 1000;
+            while (Stopwatch.GetTimestamp() < end)
+            {
+                var status = PollCancellation(control, deadline, true);
+                if (status != CallStatus.Running)
+                    return status;
+                Thread.Sleep(PollSliceMilliseconds);
+            }
+            return PollCancellation(control, deadline, true);
+        }
+
+        private const ulong FnvOffsetBasis = 14695981039346656037;
+        private const ulong FnvPrime = 1099511628211;
+
+        private static long HashJobName(ReadOnlySpan<char> jobName)
+        {
+            ulong hash = FnvOffsetBasis;
+            for (int i = 0; i < jobName.Length; i++)
+                hash = (hash ^ jobName[i]) * FnvPrime;
+            return (long)hash;
+        }
+
+        private static string GetJobName(int handle)
+        {
+            // The count is read first: the array published before it always holds that many names
+            int count = Volatile.Read(ref _jobNameCount);
+            if ((uint)handle >= (uint)count)
+                return null;
+            return Volatile.Read(ref _jobNames)[handle];
+        }
+
+        private static unsafe long GetDeadlineTimestamp(CallControlBlock* control)
+        {
+            if (control == null || control->TimeoutMilliseconds <= 0)
+                return long.MaxValue;
+            return Stopwatch.GetTimestamp() + control->TimeoutMilliseconds * Stopwatch.Frequency / 1000;
+        }
+
+        private static unsafe CallStatus PollCancellation(CallControlBlock* control, long deadline, bool checkDeadline)
+        {
+            if (Volatile.Read(ref control->CancelRequested) != 0)
+                return CallStatus.Cancelled;
+            if (checkDeadline && deadline != long.MaxValue && Stopwatch.GetTimestamp() >= deadline)
+                return CallStatus.DeadlineExceeded;
+            return CallStatus.Running;
+        }
+
+        [NativeExport(1)]
         [return: MarshalAs(UnmanagedType.Bool)]
         public static bool BoolReturn()
         {
             return true;
         }
 
+        [NativeExport(2)]
         [return: MarshalAs(UnmanagedType.R8)]
         public static double DoubleReturn()
         {
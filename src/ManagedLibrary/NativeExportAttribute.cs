@@ -0,0 +1,18 @@
+﻿using System;
+
+namespace ManagedLibraryNamespace
+{
+    // Marks a public static method as an entry point for native hosts. ExportIndexBuilder collects these methods into
+    // the export index (exports.idx) so the host can bind them by Id instead of by name.
+    // Ids must be unique across every assembly of the index and must never be reused for a different method.
+    [AttributeUsage(AttributeTargets.Method, AllowMultiple = false, Inherited = false)]
+    public sealed class NativeExportAttribute : Attribute
+    {
+        public NativeExportAttribute(int id)
+        {
+            Id = id;
+        }
+
+        public int Id { get; }
+    }
+}
@@ -0,0 +1,14 @@
+
+#ifndef _RUN_DOTNET_CORE_V22_SRC_UNMANAGEDBENCHMARK_BENCHMARKS_H_
+#define _RUN_DOTNET_CORE_V22_SRC_UNMANAGEDBENCHMARK_BENCHMARKS_H_
+
+namespace interop_dotnet_core_benchmark
+{
+    // Each benchmark receives the arguments that follow its name on the command line and returns the process exit code
+    int RunBufferBenchmark(int argc, char* argv[]);
+    int RunCancellationBenchmark(int argc, char* argv[]);
+    int RunStringBenchmark(int argc, char* argv[]);
+
+}  // namespace interop_dotnet_core_benchmark
+
+#endif  // _RUN_DOTNET_CORE_V22_SRC_UNMANAGEDBENCHMARK_BENCHMARKS_H_
@@ -0,0 +1,176 @@
+
+#include "./benchmarks.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+
+#include "../UnmanagedExecutable/interop_buffer_allocator.h"
+
+using interop_dotnet_core::InteropBufferAllocator;
+using interop_dotnet_core::InteropBufferStats;
+
+#ifdef WIN32
+#ifndef WINDOWS
+#define WINDOWS 1
+#endif
+#endif  // WIN32
+
+#if LINUX
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const size_t kPageSize = 4096;
+    const int kStridedPasses = 8;
+
+    // Counts data TLB load misses of the calling thread. Only available on Linux; elsewhere the count stays at 0.
+    class TlbMissCounter
+    {
+    public:
+        TlbMissCounter()
+            : _fd(-1)
+        {
+#if LINUX
+            perf_event_attr attr;
+            memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HW_CACHE;
+            attr.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            _fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+        }
+        ~TlbMissCounter()
+        {
+#if LINUX
+            if (_fd >= 0)
+                close(_fd);
+#endif
+        }
+        bool IsAvailable() const
+        {
+            return _fd >= 0;
+        }
+        void Start()
+        {
+#if LINUX
+            if (_fd < 0)
+                return;
+            ioctl(_fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(_fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+        }
+        uint64_t Stop()
+        {
+            uint64_t count = 0;
+#if LINUX
+            if (_fd < 0)
+                return 0;
+            ioctl(_fd, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(_fd, &count, sizeof(count)) != sizeof(count))
+                count = 0;
+#endif
+            return count;
+        }
+
+    private:
+        int _fd;
+    };
+
+    struct BufferBenchmarkResult
+    {
+        double seconds;
+        uint64_t tlb_misses;
+        double checksum;
+    };
+
+    // One simulated interop call: get a payload buffer, fill it as the caller would, read it the way the managed side
+    // walks large arrays (one element per page, several passes) and hand the buffer back
+    template <typename AllocateFunction, typename ReleaseFunction>
+    BufferBenchmarkResult RunCalls(size_t buffer_size, int calls, AllocateFunction allocate, ReleaseFunction release)
+    {
+        BufferBenchmarkResult result = {0, 0, 0};
+        size_t element_count = buffer_size / sizeof(double);
+        size_t page_stride = kPageSize / sizeof(double);
+        TlbMissCounter tlb_counter;
+        tlb_counter.Start();
+        auto start = std::chrono::steady_clock::now();
+        for (int call = 0; call < calls; call++)
+        {
+            double* data = static_cast<double*>(allocate(buffer_size));
+            if (!data)
+                return result;
+            for (size_t i = 0; i < element_count; i++)
+                data[i] = static_cast<double>(i);
+            for (int pass = 0; pass < kStridedPasses; pass++)
+            {
+                for (size_t offset = pass; offset < page_stride; offset += page_stride / kStridedPasses)
+                {
+                    for (size_t i = offset; i < element_count; i += page_stride)
+                        result.checksum += data[i];
+                }
+            }
+            release(data);
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.tlb_misses = tlb_counter.Stop();
+        return result;
+    }
+
+    void PrintResult(const char* name, size_t buffer_size, int calls, const BufferBenchmarkResult& result, bool tlb_available)
+    {
+        double gigabytes = static_cast<double>(buffer_size) * calls / (1024.0 * 1024.0 * 1024.0);
+        printf("%-28s %10.1f calls/s %8.2f GB/s", name, calls / result.seconds, gigabytes / result.seconds);
+        if (tlb_available)
+            printf(" %14.0f dTLB misses/call", static_cast<double>(result.tlb_misses) / calls);
+        else
+            printf("      dTLB misses n/a");
+        printf("  (checksum %.0f)\n", result.checksum);
+    }
+}  // namespace
+
+int interop_dotnet_core_benchmark::RunBufferBenchmark(int argc, char* argv[])
+{
+    size_t buffer_size = static_cast<size_t>(argc > 0 ? atoi(argv[0]) : 64) * 1024 * 1024;
+    int calls = argc > 1 ? atoi(argv[1]) : 50;
+    if (buffer_size == 0 || calls <= 0)
+    {
+        printf("ERROR: Buffer size and calls must be positive\n");
+        return -1;
+    }
+    bool tlb_available = TlbMissCounter().IsAvailable();
+    printf("Interop buffers: %zu MB payload, %d calls, NUMA node %d\n", buffer_size / (1024 * 1024), calls,
+        InteropBufferAllocator::GetCurrentNumaNode());
+
+    BufferBenchmarkResult malloc_result = RunCalls(
+        buffer_size, calls, [](size_t size) { return malloc(size); }, [](void* buffer) { free(buffer); });
+    PrintResult("malloc", buffer_size, calls, malloc_result, tlb_available);
+
+    InteropBufferAllocator regular_allocator(false);
+    BufferBenchmarkResult regular_result = RunCalls(
+        buffer_size, calls, [&](size_t size) { return regular_allocator.Allocate(size); },
+        [&](void* buffer) { regular_allocator.Release(buffer); });
+    PrintResult("allocator (regular pages)", buffer_size, calls, regular_result, tlb_available);
+
+    InteropBufferAllocator huge_page_allocator(true);
+    BufferBenchmarkResult huge_page_result = RunCalls(
+        buffer_size, calls, [&](size_t size) { return huge_page_allocator.Allocate(size); },
+        [&](void* buffer) { huge_page_allocator.Release(buffer); });
+    PrintResult("allocator (huge pages)", buffer_size, calls, huge_page_result, tlb_available);
+
+    InteropBufferStats stats = huge_page_allocator.GetStats();
+    printf("Huge page allocator: %llu allocations, %llu pool hits, %llu mappings (%llu explicit huge page)\n",
+        (unsigned long long)stats.allocations, (unsigned long long)stats.pool_hits, (unsigned long long)stats.mappings,
+        (unsigned long long)stats.huge_page_mappings);
+    return 0;
+}
@@ -0,0 +1,113 @@
+
+#include "./benchmarks.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../UnmanagedExecutable/dotnetcore_interop.h"
+#include "../UnmanagedExecutable/interop_cancellation.h"
+#include "../UnmanagedExecutable/managed_exports.h"
+
+using interop_dotnet_core::CallControlBlock;
+using interop_dotnet_core::CancellationSource;
+using interop_dotnet_core::DotNetCoreInterop;
+using interop_dotnet_core::kExportIndexFileName;
+using interop_dotnet_core::kSpinWorkExport;
+using interop_dotnet_core::kSpinWorkSignature;
+
+typedef double (__stdcall *SpinWorkFunctionPtr)(int64_t iterations, CallControlBlock* controlBlock);
+
+namespace
+{
+    const int kLatencyTrials = 20;
+    const int64_t kUnboundedIterations = INT64_MAX;
+    const std::chrono::milliseconds kRunBeforeCancel(20);
+
+    double MeasureSpinWork(SpinWorkFunctionPtr spin_work, int64_t iterations, CallControlBlock* control_block, double* checksum)
+    {
+        auto start = std::chrono::steady_clock::now();
+        *checksum += spin_work(iterations, control_block);
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / iterations;
+    }
+
+    void PrintLatencies(const char* name, std::vector<double>* latencies_us)
+    {
+        std::sort(latencies_us->begin(), latencies_us->end());
+        double total = 0;
+        for (size_t i = 0; i < latencies_us->size(); i++)
+            total += (*latencies_us)[i];
+        printf("%-28s min %8.1f us  avg %8.1f us  p50 %8.1f us  max %8.1f us\n", name, latencies_us->front(),
+            total / latencies_us->size(), (*latencies_us)[latencies_us->size() / 2], latencies_us->back());
+    }
+}  // namespace
+
+int interop_dotnet_core_benchmark::RunCancellationBenchmark(int argc, char* argv[])
+{
+    if (argc < 1)
+    {
+        printf("ERROR: The .Net Core libraries directory is required\n");
+        return -1;
+    }
+    int64_t iterations = argc > 1 ? atoll(argv[1]) : 100000000;
+    if (iterations <= 0)
+    {
+        printf("ERROR: Iterations must be positive\n");
+        return -1;
+    }
+
+    DotNetCoreInterop dotnetcore;
+    if (!dotnetcore.Init(argv[0]))
+        return -1;
+    if (!dotnetcore.LoadExportIndex((std::string(argv[0]) + "/" + kExportIndexFileName).c_str()))
+        return -1;
+    SpinWorkFunctionPtr spin_work;
+    if (!dotnetcore.GetFunction(kSpinWorkExport, kSpinWorkSignature, (void**)& spin_work))
+        return -1;
+
+    // Polling overhead: the same loop with and without a control block to poll (warmed up so the JIT is out of the way)
+    double checksum = 0;
+    CancellationSource cancellation;
+    MeasureSpinWork(spin_work, iterations / 10, NULL, &checksum);
+    MeasureSpinWork(spin_work, iterations / 10, cancellation.Prepare(), &checksum);
+    double plain_ns = MeasureSpinWork(spin_work, iterations, NULL, &checksum);
+    double polling_ns = MeasureSpinWork(spin_work, iterations, cancellation.Prepare(), &checksum);
+    printf("Polling overhead: %.3f ns/iteration without polling, %.3f ns/iteration with polling (%+.1f%%)\n", plain_ns, polling_ns,
+        (polling_ns - plain_ns) / plain_ns * 100);
+
+    // Cancellation latency: time from Cancel() until the managed call has returned to native code
+    std::vector<double> cancel_latencies;
+    std::vector<double> deadline_latencies;
+    for (int trial = 0; trial < kLatencyTrials; trial++)
+    {
+        cancellation.Reset();
+        CallControlBlock* control_block = cancellation.Prepare();
+        std::chrono::steady_clock::time_point returned;
+        std::thread call([&]() {
+            spin_work(kUnboundedIterations, control_block);
+            returned = std::chrono::steady_clock::now();
+        });
+        std::this_thread::sleep_for(kRunBeforeCancel);
+        auto cancelled = std::chrono::steady_clock::now();
+        cancellation.Cancel();
+        call.join();
+        cancel_latencies.push_back(std::chrono::duration<double, std::micro>(returned - cancelled).count());
+
+        cancellation.Reset();
+        auto deadline = std::chrono::steady_clock::now() + kRunBeforeCancel;
+        cancellation.SetDeadline(deadline);
+        spin_work(kUnboundedIterations, cancellation.Prepare());
+        deadline_latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - deadline).count());
+    }
+    PrintLatencies("Cancel() to return", &cancel_latencies);
+    PrintLatencies("Deadline to return", &deadline_latencies);
+    printf("(checksum %.0f)\n", checksum);
+
+    return dotnetcore.End() ? 0 : -1;
+}
@@ -0,0 +1,31 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "./benchmarks.h"
+
+void PrintUsage()
+{
+	printf("Usage: UnmanagedBenchmark <benchmark> [arguments]\n");
+	printf("  buffers [size_mb] [calls]    Interop buffer allocator against malloc (throughput and TLB misses)\n");
+	printf("  cancellation <dotnet_libs_dir> [iterations]    Cancellation latency and polling overhead of managed calls\n");
+	printf("  strings <dotnet_libs_dir> [calls]    Latency and managed allocations of LPStr, UTF-8 and interned job names\n");
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		PrintUsage();
+		return -1;
+	}
+	if (strcmp(argv[1], "buffers") == 0)
+		return interop_dotnet_core_benchmark::RunBufferBenchmark(argc - 2, argv + 2);
+	if (strcmp(argv[1], "cancellation") == 0)
+		return interop_dotnet_core_benchmark::RunCancellationBenchmark(argc - 2, argv + 2);
+	if (strcmp(argv[1], "strings") == 0)
+		return interop_dotnet_core_benchmark::RunStringBenchmark(argc - 2, argv + 2);
+
+	printf("ERROR: Unknown benchmark %s\n", argv[1]);
+	PrintUsage();
+	return -1;
+}
@@ -0,0 +1,299 @@
+
+#include "./call_trace.h"
+
+#include <string.h>
+
+using interop_dotnet_core::CallTraceReader;
+using interop_dotnet_core::CallTraceWriter;
+using interop_dotnet_core::ScopedCallRecord;
+using interop_dotnet_core::TraceArgument;
+using interop_dotnet_core::TraceCallRecord;
+using interop_dotnet_core::TraceMethod;
+
+namespace
+{
+    const char kTraceMagic[] = {'I', 'C', 'T', 'R'};
+    const size_t kTraceFileBufferSize = 1024 * 1024;
+}  // namespace
+
+const uint32_t CallTraceWriter::kAlwaysCapturedSize;
+
+CallTraceWriter::CallTraceWriter()
+    : _file(NULL)
+    , _payload_sample_rate(0)
+    , _call_count(0)
+    , _has_last_call(false)
+{
+}
+
+CallTraceWriter::~CallTraceWriter()
+{
+    Close();
+}
+
+bool CallTraceWriter::Open(const char* trace_path, unsigned int payload_sample_rate)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    if (_file)
+    {
+        printf("ERROR: A call trace is already being recorded\n");
+        return false;
+    }
+    _file = fopen(trace_path, "wb");
+    if (!_file)
+    {
+        printf("ERROR: Could not create the call trace %s\n", trace_path);
+        return false;
+    }
+    // Calls are recorded on the hot path, so only flush to disk once the buffer is full
+    _file_buffer.resize(kTraceFileBufferSize);
+    setvbuf(_file, &_file_buffer[0], _IOFBF, _file_buffer.size());
+    fwrite(kTraceMagic, 1, sizeof(kTraceMagic), _file);
+    fputc(kTraceFormatVersion, _file);
+    _payload_sample_rate = payload_sample_rate;
+    _call_count = 0;
+    _method_ids.clear();
+    _has_last_call = false;
+    printf("Recording managed calls to %s\n", trace_path);
+    return true;
+}
+
+bool CallTraceWriter::Close()
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    if (!_file)
+        return false;
+    bool closed = fclose(_file) == 0;
+    _file = NULL;
+    if (!closed)
+        printf("ERROR: Could not write the call trace\n");
+    return closed;
+}
+
+uint32_t CallTraceWriter::RegisterMethod(const char* assembly_name, const char* type_name, const char* method_name, const char* signature)
+{
+    std::string key(assembly_name);
+    key.append("|");
+    key.append(type_name);
+    key.append("|");
+    key.append(method_name);
+
+    std::lock_guard<std::mutex> guard(_lock);
+    auto found = _method_ids.find(key);
+    if (found != _method_ids.end())
+        return found->second;
+    uint32_t method_id = static_cast<uint32_t>(_method_ids.size());
+    _method_ids[key] = method_id;
+    if (_file)
+    {
+        fputc(kTraceMethodRecord, _file);
+        WriteVarint(method_id);
+        WriteString(assembly_name);
+        WriteString(type_name);
+        WriteString(method_name);
+        WriteString(signature);
+    }
+    return method_id;
+}
+
+void CallTraceWriter::RecordCall(uint32_t method_id, const TraceArgument* arguments, size_t argument_count,
+    std::chrono::steady_clock::time_point start, std::chrono::steady_clock::duration latency)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    if (!_file)
+        return;
+    // Calls from several threads can be recorded out of start order, which shows up as a zero delta
+    uint64_t delta_ns = 0;
+    if (_has_last_call && start > _last_call)
+        delta_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(start - _last_call).count();
+    if (!_has_last_call || start > _last_call)
+        _last_call = start;
+    _has_last_call = true;
+    bool sample_payloads = _payload_sample_rate != 0 && _call_count % _payload_sample_rate == 0;
+    _call_count++;
+
+    fputc(kTraceCallRecord, _file);
+    WriteVarint(method_id);
+    WriteVarint(delta_ns);
+    WriteVarint(std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+    WriteVarint(argument_count);
+    for (size_t i = 0; i < argument_count; i++)
+    {
+        bool has_payload = arguments[i].data && (arguments[i].size <= kAlwaysCapturedSize || sample_payloads);
+        fputc(arguments[i].kind, _file);
+        WriteVarint(arguments[i].size);
+        fputc(has_payload ? 1 : 0, _file);
+        if (has_payload)
+            fwrite(arguments[i].data, 1, arguments[i].size, _file);
+    }
+}
+
+void CallTraceWriter::WriteVarint(uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        fputc(static_cast<int>((value & 0x7f) | 0x80), _file);
+        value >>= 7;
+    }
+    fputc(static_cast<int>(value), _file);
+}
+
+void CallTraceWriter::WriteString(const char* value)
+{
+    size_t length = strlen(value);
+    WriteVarint(length);
+    fwrite(value, 1, length, _file);
+}
+
+ScopedCallRecord::ScopedCallRecord(CallTraceWriter* recorder, uint32_t method_id, const TraceArgument* arguments, size_t argument_count)
+    : _recorder(recorder)
+    , _method_id(method_id)
+    , _arguments(arguments)
+    , _argument_count(argument_count)
+    , _start(std::chrono::steady_clock::now())
+{
+}
+
+ScopedCallRecord::~ScopedCallRecord()
+{
+    if (_recorder)
+        _recorder->RecordCall(_method_id, _arguments, _argument_count, _start, std::chrono::steady_clock::now() - _start);
+}
+
+bool CallTraceReader::Load(const char* trace_path)
+{
+    FILE* file = fopen(trace_path, "rb");
+    if (!file)
+    {
+        printf("ERROR: Could not open the call trace %s\n", trace_path);
+        return false;
+    }
+    std::string data;
+    char chunk[64 * 1024];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        data.append(chunk, read);
+    fclose(file);
+
+    if (data.size() < sizeof(kTraceMagic) + 1 || data.compare(0, sizeof(kTraceMagic), kTraceMagic, sizeof(kTraceMagic)) != 0)
+    {
+        printf("ERROR: %s is not a call trace\n", trace_path);
+        return false;
+    }
+    if (static_cast<uint8_t>(data[sizeof(kTraceMagic)]) != kTraceFormatVersion)
+    {
+        printf("ERROR: Unsupported call trace version %d\n", data[sizeof(kTraceMagic)]);
+        return false;
+    }
+
+    _methods.clear();
+    _calls.clear();
+    size_t position = sizeof(kTraceMagic) + 1;
+    uint64_t timestamp_ns = 0;
+    bool truncated = false;
+    while (position < data.size())
+    {
+        uint8_t record_type = static_cast<uint8_t>(data[position++]);
+        uint64_t method_id;
+        if (!ReadVarint(data, &position, &method_id))
+        {
+            truncated = true;
+            break;
+        }
+        if (record_type == kTraceMethodRecord)
+        {
+            TraceMethod method;
+            if (!ReadString(data, &position, &method.assembly_name) || !ReadString(data, &position, &method.type_name)
+                || !ReadString(data, &position, &method.method_name) || !ReadString(data, &position, &method.signature))
+            {
+                truncated = true;
+                break;
+            }
+            _methods[static_cast<uint32_t>(method_id)] = method;
+            continue;
+        }
+        if (record_type != kTraceCallRecord)
+        {
+            printf("ERROR: Unknown call trace record type %d\n", record_type);
+            return false;
+        }
+
+        TraceCallRecord call;
+        uint64_t delta_ns;
+        uint64_t argument_count;
+        call.method_id = static_cast<uint32_t>(method_id);
+        if (!ReadVarint(data, &position, &delta_ns) || !ReadVarint(data, &position, &call.latency_ns)
+            || !ReadVarint(data, &position, &argument_count))
+        {
+            truncated = true;
+            break;
+        }
+        timestamp_ns += delta_ns;
+        call.timestamp_ns = timestamp_ns;
+        bool complete = true;
+        for (uint64_t i = 0; i < argument_count && complete; i++)
+        {
+            TraceArgumentRecord argument;
+            uint64_t size;
+            complete = position < data.size();
+            if (!complete)
+                break;
+            argument.kind = static_cast<uint8_t>(data[position++]);
+            complete = ReadVarint(data, &position, &size) && position < data.size();
+            if (!complete)
+                break;
+            argument.size = static_cast<uint32_t>(size);
+            argument.has_payload = data[position++] != 0;
+            if (argument.has_payload)
+            {
+                complete = data.size() - position >= size;
+                if (complete)
+                    argument.payload.assign(data, position, size);
+                position += size;
+            }
+            call.arguments.push_back(argument);
+        }
+        if (!complete)
+        {
+            truncated = true;
+            break;
+        }
+        _calls.push_back(call);
+    }
+    if (truncated)
+        printf("WARNING: Call trace %s is truncated, %zu calls loaded\n", trace_path, _calls.size());
+    return true;
+}
+
+const std::map<uint32_t, TraceMethod>& CallTraceReader::GetMethods() const
+{
+    return _methods;
+}
+
+const std::vector<TraceCallRecord>& CallTraceReader::GetCalls() const
+{
+    return _calls;
+}
+
+bool CallTraceReader::ReadVarint(const std::string& data, size_t* position, uint64_t* value)
+{
+    *value = 0;
+    for (int shift = 0; shift < 64 && *position < data.size(); shift += 7)
+    {
+        uint8_t byte = static_cast<uint8_t>(data[(*position)++]);
+        *value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+bool CallTraceReader::ReadString(const std::string& data, size_t* position, std::string* value)
+{
+    uint64_t length;
+    if (!ReadVarint(data, position, &length) || data.size() - *position < length)
+        return false;
+    value->assign(data, *position, length);
+    *position += length;
+    return true;
+}
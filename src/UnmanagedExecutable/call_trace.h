@@ -0,0 +1,136 @@
+
+#ifndef _RUN_DOTNET_CORE_V22_SRC_UNMANAGEDEXECUTABLE_CALL_TRACE_H_
+#define _RUN_DOTNET_CORE_V22_SRC_UNMANAGEDEXECUTABLE_CALL_TRACE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace interop_dotnet_core
+{
+    // Trace file layout (all integers are LEB128 varints unless noted):
+    //   header: "ICTR" magic, format version (1 byte)
+    //   method record: kTraceMethodRecord (1 byte), method id, assembly, type, method, signature (length prefixed strings)
+    //   call record:   kTraceCallRecord (1 byte), method id, timestamp delta from the previous call (ns), latency (ns),
+    //                  argument count, then per argument: kind (1 byte), size, payload flag (1 byte), payload bytes when flagged
+    // The signature uses the ExportIndexBuilder notation, e.g. "str(str,i32,i32,f64[],fn)".
+    const uint8_t kTraceFormatVersion = 2;
+    const uint8_t kTraceMethodRecord = 1;
+    const uint8_t kTraceCallRecord = 2;
+
+    // Every parameter of the managed method is recorded in order, including the ones that carry no data, so a call
+    // can be rebuilt from the trace alone
+    enum TraceArgumentKind
+    {
+        kTraceArgumentInt32 = 1,
+        kTraceArgumentInt64,
+        kTraceArgumentFloat64,
+        kTraceArgumentString,        // Marshalled as LPStr, the payload excludes the terminator
+        kTraceArgumentBytes,         // Pointer to a native buffer such as a UTF-8 span, the payload is the buffer
+        kTraceArgumentFloat64Array,  // Pointer to doubles, the payload is the array
+        kTraceArgumentCallback,      // Native callback, no payload
+        kTraceArgumentControlBlock   // CallControlBlock*, the payload is the call timeout in ms (int64), none for NULL
+    };
+
+    struct TraceArgument
+    {
+        uint8_t kind;
+        const void* data;
+        uint32_t size;
+    };
+
+    // Records managed invocations into a compact binary trace. Scalar arguments (up to kAlwaysCapturedSize bytes) are
+    // always captured; larger payloads are captured once every payload_sample_rate calls (0 never captures them).
+    class CallTraceWriter
+    {
+    public:
+        static const uint32_t kAlwaysCapturedSize = 16;
+
+    public:
+        CallTraceWriter();
+        ~CallTraceWriter();
+        bool Open(const char* trace_path, unsigned int payload_sample_rate);
+        bool Close();
+        uint32_t RegisterMethod(const char* assembly_name, const char* type_name, const char* method_name, const char* signature);
+        void RecordCall(uint32_t method_id, const TraceArgument* arguments, size_t argument_count,
+            std::chrono::steady_clock::time_point start, std::chrono::steady_clock::duration latency);
+
+    private:
+        void WriteVarint(uint64_t value);
+        void WriteString(const char* value);
+
+    private:
+        std::mutex _lock;
+        FILE* _file;
+        std::vector<char> _file_buffer;
+        unsigned int _payload_sample_rate;
+        uint64_t _call_count;
+        std::map<std::string, uint32_t> _method_ids;
+        std::chrono::steady_clock::time_point _last_call;
+        bool _has_last_call;
+    };
+
+    // Measures one managed invocation and records it when it goes out of scope (no-op when recorder is NULL)
+    class ScopedCallRecord
+    {
+    public:
+        ScopedCallRecord(CallTraceWriter* recorder, uint32_t method_id, const TraceArgument* arguments, size_t argument_count);
+        ~ScopedCallRecord();
+
+    private:
+        CallTraceWriter* _recorder;
+        uint32_t _method_id;
+        const TraceArgument* _arguments;
+        size_t _argument_count;
+        std::chrono::steady_clock::time_point _start;
+    };
+
+    struct TraceMethod
+    {
+        std::string assembly_name;
+        std::string type_name;
+        std::string method_name;
+        std::string signature;
+    };
+
+    struct TraceArgumentRecord
+    {
+        uint8_t kind;
+        uint32_t size;
+        bool has_payload;
+        std::string payload;
+    };
+
+    struct TraceCallRecord
+    {
+        uint32_t method_id;
+        uint64_t timestamp_ns;  // Since the first call of the trace
+        uint64_t latency_ns;
+        std::vector<TraceArgumentRecord> arguments;
+    };
+
+    class CallTraceReader
+    {
+    public:
+        bool Load(const char* trace_path);
+        const std::map<uint32_t, TraceMethod>& GetMethods() const;
+        const std::vector<TraceCallRecord>& GetCalls() const;
+
+    private:
+        bool ReadVarint(const std::string& data, size_t* position, uint64_t* value);
+        bool ReadString(const std::string& data, size_t* position, std::string* value);
+
+    private:
+        std::map<uint32_t, TraceMethod> _methods;
+        std::vector<TraceCallRecord> _calls;
+    };
+
+}  // namespace interop_dotnet_core
+
+#endif  // _RUN_DOTNET_CORE_V22_SRC_UNMANAGEDEXECUTABLE_CALL_TRACE_H_
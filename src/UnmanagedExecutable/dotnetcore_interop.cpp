@@ -1,9 +1,17 @@
 
 #include "./dotnetcore_interop.h"
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include <string>
 
+using interop_dotnet_core::CallTraceWriter;
 using interop_dotnet_core::DotNetCoreInterop;
+using interop_dotnet_core::ExportIndex;
+using interop_dotnet_core::ExportIndexEntry;
+using interop_dotnet_core::MethodProfiler;
 
 #include "coreclrhost.h"
 
@@ -44,6 +52,8 @@ DotNetCoreInterop::DotNetCoreInterop()
     , _coreclr_shutdown_ptr(NULL)
     , _host_handle(NULL)
     , _domain_id(0)
+    , _recording(false)
+    , _profiling(false)
 {
 }
 
@@ -51,10 +61,30 @@ DotNetCoreInterop::~DotNetCoreInterop()
 {
 }
 
-bool DotNetCoreInterop::Init(const char* dotnet_libs_dir)
+bool DotNetCoreInterop::Init(const char* dotnet_libs_dir, int profiling_flags)
 {
+    // The runtime reads its configuration from the environment when it starts, so this must happen before it is loaded.
+    // Both prefixes are set: .Net Core 2.2 reads COMPlus_, later runtimes read DOTNET_.
+    if (profiling_flags & kProfilingPerfMap)
+    {
+#if WINDOWS
+        _putenv_s("COMPlus_PerfMapEnabled", "1");
+        _putenv_s("DOTNET_PerfMapEnabled", "1");
+#elif LINUX
+        setenv("COMPlus_PerfMapEnabled", "1", 1);
+        setenv("DOTNET_PerfMapEnabled", "1", 1);
+#endif
+        printf("Perf map enabled for JIT-compiled code\n");
+    }
+    if (profiling_flags & kProfilingHardwareCounters)
+    {
+        _profiling = MethodProfiler::IsSupported();
+        if (!_profiling)
+            printf("WARNING: Hardware counters are not available, managed calls will not be profiled\n");
+    }
+
     // Load .Net Core Runtime - We assume the the .Net Core was fully published with the libraries (Self Contained Publish)
-    std::string dotnet_runtime_lib_name = "coreclr.dll";
+    std::string dotnet_runtime_lib_name = CORECLR_FILE_NAME;
     std::string core_clr_path(dotnet_libs_dir);
     core_clr_path.append(FS_SEPARATOR);
     core_clr_path.append(dotnet_runtime_lib_name);
@@ -146,12 +176,57 @@ bool DotNetCoreInterop::ReleaseReturn(char* return_to_release)
 bool DotNetCoreInterop::GetFunction(
     const char* assembly_name, const char* namespace_name, const char* class_name, const char* function_name, void** function_pointer)
 {
-    // The assembly name passed in the third parameter is a managed assembly name as described at
-    // https://docs.microsoft.com/dotnet/framework/app-domains/assembly-names
     std::string full_class_name(namespace_name);
     full_class_name.append(".");
     full_class_name.append(class_name);
-    int hr = _coreclr_create_delegate_ptr(_host_handle, _domain_id, assembly_name, full_class_name.c_str(), function_name, function_pointer);
+    return CreateDelegate(assembly_name, full_class_name.c_str(), function_name, function_pointer);
+}
+
+bool DotNetCoreInterop::LoadExportIndex(const char* index_path)
+{
+    // Only the index is mapped here; assemblies are loaded by the runtime when their first method is bound
+    if (!_export_index.Open(index_path))
+        return false;
+    std::lock_guard<std::mutex> guard(_bound_functions_lock);
+    _bound_functions.clear();
+    printf("Loaded export index from %s\n", index_path);
+    return true;
+}
+
+bool DotNetCoreInterop::GetFunction(uint32_t method_id, const char* expected_signature, void** function_pointer)
+{
+    std::lock_guard<std::mutex> guard(_bound_functions_lock);
+    const ExportIndexEntry* entry = _export_index.Find(method_id);
+    if (!entry)
+    {
+        printf("ERROR: Managed export %u is not in the export index\n", method_id);
+        return false;
+    }
+    // The delegate is called through a C++ function pointer type, so a signature mismatch would corrupt the stack.
+    // Checked on every call, including the ones answered from the bound functions below.
+    if (entry->signature_hash != ExportIndex::HashSignature(expected_signature))
+    {
+        printf("ERROR: Managed export %u (%s.%s) does not match the signature %s\n", method_id, _export_index.GetTypeName(*entry),
+            _export_index.GetMethodName(*entry), expected_signature);
+        return false;
+    }
+    auto bound = _bound_functions.find(method_id);
+    if (bound != _bound_functions.end())
+    {
+        *function_pointer = bound->second;
+        return true;
+    }
+    if (!CreateDelegate(_export_index.GetAssemblyName(*entry), _export_index.GetTypeName(*entry), _export_index.GetMethodName(*entry), function_pointer))
+        return false;
+    _bound_functions[method_id] = *function_pointer;
+    return true;
+}
+
+bool DotNetCoreInterop::CreateDelegate(const char* assembly_name, const char* type_name, const char* method_name, void** function_pointer)
+{
+    // The assembly name passed in the third parameter is a managed assembly name as described at
+    // https://docs.microsoft.com/dotnet/framework/app-domains/assembly-names
+    int hr = _coreclr_create_delegate_ptr(_host_handle, _domain_id, assembly_name, type_name, method_name, function_pointer);
     if (hr < 0)
     {
         printf("coreclr_create_delegate failed - status: 0x%08x\n", hr);
@@ -162,8 +237,40 @@ bool DotNetCoreInterop::GetFunction(
     return true;
 }
 
+bool DotNetCoreInterop::StartRecording(const char* trace_path, unsigned int payload_sample_rate)
+{
+    // Every managed call made through GetRecorder() is captured until StopRecording or End
+    if (!_recorder.Open(trace_path, payload_sample_rate))
+        return false;
+    _recording = true;
+    return true;
+}
+
+bool DotNetCoreInterop::StopRecording()
+{
+    if (!_recording)
+        return false;
+    _recording = false;
+    return _recorder.Close();
+}
+
+CallTraceWriter* DotNetCoreInterop::GetRecorder()
+{
+    return _recording ? &_recorder : NULL;
+}
+
+MethodProfiler* DotNetCoreInterop::GetProfiler()
+{
+    return _profiling ? &_profiler : NULL;
+}
+
 bool DotNetCoreInterop::End()
 {
+    if (_recording)
+        StopRecording();
+    if (_profiling)
+        _profiler.PrintReport();
+
     // Shutdown CoreCLR
     int hr = _coreclr_shutdown_ptr(_host_handle, _domain_id);
     if (hr < 0)
@@ -219,6 +326,8 @@ bool DotNetCoreInterop::BuildTpaList(const char* directory, const char* extensio
 bool DotNetCoreInterop::BuildTpaList(const char* directory, const char* extension, std::string* tap_list)
 {
     DIR* dir = opendir(directory);
+    if (dir == NULL)
+        return false;
     struct dirent* entry;
     int extension_length = strlen(extension);
     while ((entry = readdir(dir)) != NULL)
@@ -244,7 +353,8 @@ bool DotNetCoreInterop::BuildTpaList(const char* directory, const char* extensio
         //
         // For this simple sample, though, and because we're only loading TPA assemblies from a single path,
         // and have no native images, we can ignore that complication.
-        return true;
     }
+    closedir(dir);
+    return true;
 }
 #endif
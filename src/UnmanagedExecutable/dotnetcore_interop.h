@@ -3,23 +3,45 @@
 #define _RUN_DOTNET_CORE_V22_SRC_UNMANAGEDEXECUTABLE_DOTNETCORE_INTEROP_H_
 
 #include "coreclrhost.h"
+#include "call_trace.h"
+#include "export_index.h"
+#include "perf_counters.h"
 
+#include <stdint.h>
+
+#include <mutex>
 #include <string>
+#include <unordered_map>
 
 namespace interop_dotnet_core
 {
+    // Profiling modes of DotNetCoreInterop::Init (may be combined)
+    enum ProfilingFlags
+    {
+        kProfilingNone = 0,
+        kProfilingPerfMap = 1,          // The runtime writes /tmp/perf-<pid>.map so perf can symbolize JIT-compiled frames
+        kProfilingHardwareCounters = 2  // Calls wrapped in ScopedMethodProfile are counted per method
+    };
+
     class DotNetCoreInterop
     {
     public:
         DotNetCoreInterop();
         ~DotNetCoreInterop();
-        bool Init(const char* dotnet_libs_dir);
+        bool Init(const char* dotnet_libs_dir, int profiling_flags = kProfilingNone);
         bool End();
         bool GetFunction(const char* assembly_name, const char* namespace_name, const char* class_name, const char* function_name, void** function_pointer);
+        bool LoadExportIndex(const char* index_path);
+        bool GetFunction(uint32_t method_id, const char* expected_signature, void** function_pointer);
         bool ReleaseReturn(char* return_to_release);
+        bool StartRecording(const char* trace_path, unsigned int payload_sample_rate);
+        bool StopRecording();
+        CallTraceWriter* GetRecorder();
+        MethodProfiler* GetProfiler();
 
     private:
         bool BuildTpaList(const char* directory, const char* extension, std::string* tap_list);
+        bool CreateDelegate(const char* assembly_name, const char* type_name, const char* method_name, void** function_pointer);
 
     private:
         coreclr_initialize_ptr _coreclr_initialize_ptr;
@@ -27,6 +49,13 @@ namespace interop_dotnet_core
         coreclr_shutdown_ptr _coreclr_shutdown_ptr;
         void* _host_handle;
         unsigned int _domain_id;
+        CallTraceWriter _recorder;
+        bool _recording;
+        MethodProfiler _profiler;
+        bool _profiling;
+        ExportIndex _export_index;
+        std::mutex _bound_functions_lock;
+        std::unordered_map<uint32_t, void*> _bound_functions;
     };
 
 }  // namespace interop_dotnet_core
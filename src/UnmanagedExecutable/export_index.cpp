@@ -0,0 +1,213 @@
+
+#include "./export_index.h"
+
+#include <stdio.h>
+#include <string.h>
+
+using interop_dotnet_core::ExportIndex;
+using interop_dotnet_core::ExportIndexEntry;
+
+#ifdef WIN32
+#ifndef WINDOWS
+#define WINDOWS 1
+#endif
+#endif  // WIN32
+
+#if WINDOWS
+#include <Windows.h>
+#elif LINUX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    const char kExportIndexMagic[] = {'M', 'X', 'I', 'X'};
+    const uint32_t kExportIndexVersion = 1;
+    const uint64_t kFnvOffsetBasis = 14695981039346656037ULL;
+    const uint64_t kFnvPrime = 1099511628211ULL;
+}  // namespace
+
+ExportIndex::ExportIndex()
+    : _data(NULL)
+    , _size(0)
+    , _header(NULL)
+    , _entries(NULL)
+    , _file_handle(NULL)
+    , _mapping_handle(NULL)
+{
+}
+
+ExportIndex::~ExportIndex()
+{
+    Close();
+}
+
+bool ExportIndex::Open(const char* index_path)
+{
+    Close();
+#if WINDOWS
+    HANDLE file = CreateFileA(index_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        printf("ERROR: Could not open the export index %s\n", index_path);
+        return false;
+    }
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(file, &file_size);
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    void* data = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!data)
+    {
+        printf("ERROR: Could not map the export index %s\n", index_path);
+        if (mapping)
+            CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    _file_handle = file;
+    _mapping_handle = mapping;
+    _size = static_cast<size_t>(file_size.QuadPart);
+#elif LINUX
+    int file = open(index_path, O_RDONLY);
+    if (file < 0)
+    {
+        printf("ERROR: Could not open the export index %s\n", index_path);
+        return false;
+    }
+    struct stat file_stat;
+    void* data = MAP_FAILED;
+    if (fstat(file, &file_stat) == 0 && file_stat.st_size > 0)
+        data = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    // The mapping stays valid once the descriptor is closed
+    close(file);
+    if (data == MAP_FAILED)
+    {
+        printf("ERROR: Could not map the export index %s\n", index_path);
+        return false;
+    }
+    _size = static_cast<size_t>(file_stat.st_size);
+#endif
+    _data = static_cast<const char*>(data);
+    if (!Validate(index_path))
+    {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void ExportIndex::Close()
+{
+    if (!_data)
+        return;
+#if WINDOWS
+    UnmapViewOfFile(_data);
+    CloseHandle(_mapping_handle);
+    CloseHandle(_file_handle);
+    _mapping_handle = NULL;
+    _file_handle = NULL;
+#elif LINUX
+    munmap(const_cast<char*>(_data), _size);
+#endif
+    _data = NULL;
+    _size = 0;
+    _header = NULL;
+    _entries = NULL;
+}
+
+bool ExportIndex::IsOpen() const
+{
+    return _data != NULL;
+}
+
+const ExportIndexEntry* ExportIndex::Find(uint32_t method_id) const
+{
+    if (!_entries)
+        return NULL;
+    // Entries are sorted by id at build time
+    uint32_t low = 0;
+    uint32_t high = _header->entry_count;
+    while (low < high)
+    {
+        uint32_t middle = low + (high - low) / 2;
+        if (_entries[middle].method_id < method_id)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if (low < _header->entry_count && _entries[low].method_id == method_id)
+        return &_entries[low];
+    return NULL;
+}
+
+const char* ExportIndex::GetAssemblyName(const ExportIndexEntry& entry) const
+{
+    return GetString(entry.assembly_name_offset);
+}
+
+const char* ExportIndex::GetTypeName(const ExportIndexEntry& entry) const
+{
+    return GetString(entry.type_name_offset);
+}
+
+const char* ExportIndex::GetMethodName(const ExportIndexEntry& entry) const
+{
+    return GetString(entry.method_name_offset);
+}
+
+uint64_t ExportIndex::HashSignature(const char* signature)
+{
+    // FNV-1a 64-bit, must match ExportIndexBuilder.HashSignature
+    uint64_t hash = kFnvOffsetBasis;
+    for (const unsigned char* value = reinterpret_cast<const unsigned char*>(signature); *value; value++)
+    {
+        hash ^= *value;
+        hash *= kFnvPrime;
+    }
+    return hash;
+}
+
+const char* ExportIndex::GetString(uint32_t offset) const
+{
+    return _data + _header->string_table_offset + offset;
+}
+
+bool ExportIndex::Validate(const char* index_path)
+{
+    // Everything is checked once here so lookups can trust the offsets
+    const ExportIndexHeader* header = reinterpret_cast<const ExportIndexHeader*>(_data);
+    if (_size < sizeof(ExportIndexHeader) || memcmp(header->magic, kExportIndexMagic, sizeof(kExportIndexMagic)) != 0)
+    {
+        printf("ERROR: %s is not an export index\n", index_path);
+        return false;
+    }
+    if (header->version != kExportIndexVersion)
+    {
+        printf("ERROR: Unsupported export index version %u\n", header->version);
+        return false;
+    }
+    size_t entries_end = sizeof(ExportIndexHeader) + static_cast<size_t>(header->entry_count) * sizeof(ExportIndexEntry);
+    if (entries_end > _size || header->string_table_offset < entries_end || header->string_table_offset > _size
+        || (header->string_table_offset < _size && _data[_size - 1] != '\0'))
+    {
+        printf("ERROR: Export index %s is corrupted\n", index_path);
+        return false;
+    }
+    const ExportIndexEntry* entries = reinterpret_cast<const ExportIndexEntry*>(_data + sizeof(ExportIndexHeader));
+    size_t string_table_size = _size - header->string_table_offset;
+    for (uint32_t i = 0; i < header->entry_count; i++)
+    {
+        if (entries[i].assembly_name_offset >= string_table_size || entries[i].type_name_offset >= string_table_size
+            || entries[i].method_name_offset >= string_table_size || (i > 0 && entries[i - 1].method_id >= entries[i].method_id))
+        {
+            printf("ERROR: Export index %s is corrupted\n", index_path);
+            return false;
+        }
+    }
+    _header = header;
+    _entries = entries;
+    return true;
+}
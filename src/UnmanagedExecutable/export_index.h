@@ -0,0 +1,62 @@
+
+#ifndef _RUN_DOTNET_CORE_V22_SRC_UNMANAGEDEXECUTABLE_EXPORT_INDEX_H_
+#define _RUN_DOTNET_CORE_V22_SRC_UNMANAGEDEXECUTABLE_EXPORT_INDEX_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace interop_dotnet_core
+{
+    // Layout written by ExportIndexBuilder (see src/ExportIndexBuilder/Program.cs)
+    struct ExportIndexHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint32_t entry_count;
+        uint32_t string_table_offset;
+    };
+
+    struct ExportIndexEntry
+    {
+        uint32_t method_id;
+        uint32_t assembly_name_offset;
+        uint32_t type_name_offset;
+        uint32_t method_name_offset;
+        uint32_t reserved[2];
+        uint64_t signature_hash;
+    };
+    static_assert(sizeof(ExportIndexHeader) == 16, "ExportIndexHeader layout must match ExportIndexBuilder");
+    static_assert(sizeof(ExportIndexEntry) == 32, "ExportIndexEntry layout must match ExportIndexBuilder");
+
+    // Read-only view of the managed export index. The file is memory-mapped, so opening it costs the same whatever
+    // the number of exported methods and nothing is copied.
+    class ExportIndex
+    {
+    public:
+        ExportIndex();
+        ~ExportIndex();
+        bool Open(const char* index_path);
+        void Close();
+        bool IsOpen() const;
+        const ExportIndexEntry* Find(uint32_t method_id) const;
+        const char* GetAssemblyName(const ExportIndexEntry& entry) const;
+        const char* GetTypeName(const ExportIndexEntry& entry) const;
+        const char* GetMethodName(const ExportIndexEntry& entry) const;
+        static uint64_t HashSignature(const char* signature);
+
+    private:
+        const char* GetString(uint32_t offset) const;
+        bool Validate(const char* index_path);
+
+    private:
+        const char* _data;
+        size_t _size;
+        const ExportIndexHeader* _header;
+        const ExportIndexEntry* _entries;
+        void* _file_handle;     // Windows only
+        void* _mapping_handle;  // Windows only
+    };
+
+}  // namespace interop_dotnet_core
+
+#endif  // _RUN_DOTNET_CORE_V22_SRC_UNMANAGEDEXECUTABLE_EXPORT_INDEX_H_
@@ -0,0 +1,47 @@
+
+#include "./interned_strings.h"
+
+#include <stdio.h>
+#include <string.h>
+
+using interop_dotnet_core::InternedStringTable;
+
+InternedStringTable::InternedStringTable(RegisterStringFunctionPtr register_function)
+    : _register_function(register_function)
+{
+}
+
+int32_t InternedStringTable::Intern(const char* value)
+{
+    return Intern(value, strlen(value));
+}
+
+int32_t InternedStringTable::Intern(const char* value, size_t length)
+{
+    if (length > INT32_MAX)
+    {
+        printf("ERROR: String of %zu bytes is too long to intern\n", length);
+        return kInvalidStringHandle;
+    }
+    std::string key(value, length);
+    std::lock_guard<std::mutex> guard(_lock);
+    auto handle = _handles.find(key);
+    if (handle != _handles.end())
+        return handle->second;
+
+    // Registered under the lock so concurrent callers of a new string get the same handle
+    int32_t registered = _register_function(value, static_cast<int32_t>(length));
+    if (registered == kInvalidStringHandle)
+    {
+        printf("ERROR: The managed side could not intern \"%s\"\n", key.c_str());
+        return kInvalidStringHandle;
+    }
+    _handles.emplace(std::move(key), registered);
+    return registered;
+}
+
+size_t InternedStringTable::GetCount() const
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    return _handles.size();
+}
@@ -0,0 +1,38 @@
+
+#ifndef _RUN_DOTNET_CORE_V22_SRC_UNMANAGEDEXECUTABLE_INTERNED_STRINGS_H_
+#define _RUN_DOTNET_CORE_V22_SRC_UNMANAGEDEXECUTABLE_INTERNED_STRINGS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace interop_dotnet_core
+{
+    // Managed registration function (ManagedClass.RegisterJobName): takes a UTF-8 string and returns its handle
+    typedef int32_t (__stdcall *RegisterStringFunctionPtr)(const char* value, int32_t length);
+
+    const int32_t kInvalidStringHandle = -1;
+
+    // Native side of the managed string interning table. Each distinct string crosses the boundary once, when it is
+    // interned; afterwards calls pass the returned integer handle, which costs neither marshalling nor a managed
+    // allocation. Intern() hashes the string, so callers on hot paths should keep the handle rather than look it up per call.
+    class InternedStringTable
+    {
+    public:
+        explicit InternedStringTable(RegisterStringFunctionPtr register_function);
+        int32_t Intern(const char* value);
+        int32_t Intern(const char* value, size_t length);
+        size_t GetCount() const;
+
+    private:
+        RegisterStringFunctionPtr _register_function;
+        mutable std::mutex _lock;
+        std::unordered_map<std::string, int32_t> _handles;
+    };
+
+}  // namespace interop_dotnet_core
+
+#endif  // _RUN_DOTNET_CORE_V22_SRC_UNMANAGEDEXECUTABLE_INTERNED_STRINGS_H_
@@ -0,0 +1,266 @@
+
+#include "./interop_buffer_allocator.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+using interop_dotnet_core::InteropBufferAllocator;
+using interop_dotnet_core::InteropBufferStats;
+
+#ifdef WIN32
+#ifndef WINDOWS
+#define WINDOWS 1
+#endif
+#endif  // WIN32
+
+#if WINDOWS
+#include <Windows.h>
+#include <malloc.h>
+#elif LINUX
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+#endif
+
+const size_t InteropBufferAllocator::kSimdAlignment;
+const size_t InteropBufferAllocator::kPageSize;
+const size_t InteropBufferAllocator::kHugePageSize;
+const size_t InteropBufferAllocator::kLargeBufferThreshold;
+const int InteropBufferAllocator::kCurrentNumaNode;
+
+InteropBufferAllocator::InteropBufferAllocator(bool use_huge_pages, size_t max_pooled_bytes)
+    : _use_huge_pages(use_huge_pages)
+    , _max_pooled_bytes(max_pooled_bytes)
+    , _stats()
+{
+}
+
+InteropBufferAllocator::~InteropBufferAllocator()
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    for (auto buffer = _buffers.begin(); buffer != _buffers.end(); ++buffer)
+        UnmapBuffer(buffer->first, buffer->second);
+    for (auto pool = _pool.begin(); pool != _pool.end(); ++pool)
+    {
+        for (size_t i = 0; i < pool->second.size(); i++)
+        {
+            BufferInfo info = {pool->first.second, pool->first.first, pool->second[i].second};
+            UnmapBuffer(pool->second[i].first, info);
+        }
+    }
+}
+
+void* InteropBufferAllocator::Allocate(size_t size, int numa_node)
+{
+    if (size == 0)
+        return NULL;
+
+    // Small payloads are cheaper to serve from the heap than to map
+    if (size < kLargeBufferThreshold)
+    {
+        size_t aligned_size = (size + kSimdAlignment - 1) & ~(kSimdAlignment - 1);
+#if WINDOWS
+        void* buffer = _aligned_malloc(aligned_size, kSimdAlignment);
+#elif LINUX
+        void* buffer = NULL;
+        if (posix_memalign(&buffer, kSimdAlignment, aligned_size) != 0)
+            buffer = NULL;
+#endif
+        if (!buffer)
+        {
+            printf("ERROR: Could not allocate an interop buffer of %zu bytes\n", size);
+            return NULL;
+        }
+        BufferInfo info = {0, kCurrentNumaNode, false};
+        std::lock_guard<std::mutex> guard(_lock);
+        _buffers[buffer] = info;
+        _stats.allocations++;
+        return buffer;
+    }
+
+    size_t granularity = _use_huge_pages && size >= kHugePageSize ? kHugePageSize : kPageSize;
+    size_t mapped_size = (size + granularity - 1) & ~(granularity - 1);
+    if (numa_node == kCurrentNumaNode)
+        numa_node = GetCurrentNumaNode();
+    {
+        std::lock_guard<std::mutex> guard(_lock);
+        _stats.allocations++;
+        auto pool = _pool.find(std::make_pair(numa_node, mapped_size));
+        if (pool != _pool.end() && !pool->second.empty())
+        {
+            std::pair<void*, bool> pooled = pool->second.back();
+            pool->second.pop_back();
+            _stats.pooled_bytes -= mapped_size;
+            _stats.pool_hits++;
+            BufferInfo info = {mapped_size, numa_node, pooled.second};
+            _buffers[pooled.first] = info;
+            return pooled.first;
+        }
+    }
+
+    bool huge_pages = false;
+    void* buffer = MapBuffer(mapped_size, numa_node, &huge_pages);
+    if (!buffer)
+    {
+        printf("ERROR: Could not map an interop buffer of %zu bytes\n", mapped_size);
+        return NULL;
+    }
+    BufferInfo info = {mapped_size, numa_node, huge_pages};
+    std::lock_guard<std::mutex> guard(_lock);
+    _buffers[buffer] = info;
+    _stats.mappings++;
+    if (huge_pages)
+        _stats.huge_page_mappings++;
+    return buffer;
+}
+
+bool InteropBufferAllocator::Release(void* buffer)
+{
+    if (!buffer)
+        return false;
+
+    std::lock_guard<std::mutex> guard(_lock);
+    auto found = _buffers.find(buffer);
+    if (found == _buffers.end())
+    {
+        printf("ERROR: Released buffer was not allocated by the interop allocator\n");
+        return false;
+    }
+    BufferInfo info = found->second;
+    _buffers.erase(found);
+    if (info.mapped_size == 0 || _stats.pooled_bytes + info.mapped_size > _max_pooled_bytes)
+    {
+        UnmapBuffer(buffer, info);
+        return true;
+    }
+
+    // Keep the mapping (and its page table entries) for the next call that needs a buffer of the same size
+    _pool[std::make_pair(info.numa_node, info.mapped_size)].push_back(std::make_pair(buffer, info.huge_pages));
+    _stats.pooled_bytes += info.mapped_size;
+    return true;
+}
+
+void InteropBufferAllocator::Trim()
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    for (auto pool = _pool.begin(); pool != _pool.end(); ++pool)
+    {
+        for (size_t i = 0; i < pool->second.size(); i++)
+        {
+            BufferInfo info = {pool->first.second, pool->first.first, pool->second[i].second};
+            UnmapBuffer(pool->second[i].first, info);
+        }
+    }
+    _pool.clear();
+    _stats.pooled_bytes = 0;
+}
+
+InteropBufferStats InteropBufferAllocator::GetStats() const
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    return _stats;
+}
+
+int InteropBufferAllocator::GetCurrentNumaNode()
+{
+#if WINDOWS
+    PROCESSOR_NUMBER processor;
+    GetCurrentProcessorNumberEx(&processor);
+    USHORT node = 0;
+    if (GetNumaProcessorNodeEx(&processor, &node))
+        return node;
+#elif LINUX && defined(SYS_getcpu)
+    unsigned int cpu = 0;
+    unsigned int node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0)
+        return static_cast<int>(node);
+#endif
+    return 0;
+}
+
+#if WINDOWS
+void* InteropBufferAllocator::MapBuffer(size_t mapped_size, int numa_node, bool* huge_pages)
+{
+    // Large pages need the SeLockMemoryPrivilege, so fall back to regular pages when they are not available
+    void* buffer = NULL;
+    SIZE_T large_page_size = GetLargePageMinimum();
+    if (_use_huge_pages && mapped_size >= kHugePageSize && large_page_size != 0 && mapped_size % large_page_size == 0)
+        buffer = VirtualAllocExNuma(GetCurrentProcess(), NULL, mapped_size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE, numa_node);
+    *huge_pages = buffer != NULL;
+    if (!buffer)
+        buffer = VirtualAllocExNuma(GetCurrentProcess(), NULL, mapped_size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, numa_node);
+    return buffer;
+}
+
+void InteropBufferAllocator::UnmapBuffer(void* buffer, const BufferInfo& info)
+{
+    if (info.mapped_size == 0)
+    {
+        _aligned_free(buffer);
+        return;
+    }
+    VirtualFree(buffer, 0, MEM_RELEASE);
+    _stats.unmappings++;
+}
+#elif LINUX
+void* InteropBufferAllocator::MapBuffer(size_t mapped_size, int numa_node, bool* huge_pages)
+{
+    // Mappings rounded to regular pages would be rounded up again by the kernel if backed by huge pages
+    bool huge_page_sized = _use_huge_pages && mapped_size % kHugePageSize == 0;
+    void* buffer = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    // Explicit huge pages only succeed when the administrator reserved them (vm.nr_hugepages)
+    if (huge_page_sized)
+        buffer = mmap(NULL, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+    *huge_pages = buffer != MAP_FAILED;
+    if (buffer == MAP_FAILED && huge_page_sized)
+    {
+        // Map regular pages on a huge page boundary so transparent huge pages can still back the buffer
+        size_t reserved_size = mapped_size + kHugePageSize;
+        char* reserved = static_cast<char*>(mmap(NULL, reserved_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+        if (reserved == MAP_FAILED)
+            return NULL;
+        char* aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(reserved) + kHugePageSize - 1) & ~(kHugePageSize - 1));
+        if (aligned != reserved)
+            munmap(reserved, aligned - reserved);
+        if (aligned + mapped_size != reserved + reserved_size)
+            munmap(aligned + mapped_size, reserved + reserved_size - (aligned + mapped_size));
+        buffer = aligned;
+#ifdef MADV_HUGEPAGE
+        madvise(buffer, mapped_size, MADV_HUGEPAGE);
+#endif
+    }
+    else if (buffer == MAP_FAILED)
+    {
+        buffer = mmap(NULL, mapped_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (buffer == MAP_FAILED)
+            return NULL;
+    }
+
+#ifdef SYS_mbind
+    // Pages are not faulted in yet, so the policy decides where the first touch places them
+    if (numa_node >= 0 && numa_node < static_cast<int>(sizeof(unsigned long) * 8))
+    {
+        unsigned long node_mask = 1UL << numa_node;
+        if (syscall(SYS_mbind, buffer, mapped_size, MPOL_PREFERRED, &node_mask, sizeof(node_mask) * 8, 0) != 0)
+            printf("WARNING: Could not place the interop buffer on NUMA node %d\n", numa_node);
+    }
+#endif
+    return buffer;
+}
+
+void InteropBufferAllocator::UnmapBuffer(void* buffer, const BufferInfo& info)
+{
+    if (info.mapped_size == 0)
+    {
+        free(buffer);
+        return;
+    }
+    munmap(buffer, info.mapped_size);
+    _stats.unmappings++;
+}
+#endif
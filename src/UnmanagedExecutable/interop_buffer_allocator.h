@@ -0,0 +1,74 @@
+
+#ifndef _RUN_DOTNET_CORE_V22_SRC_UNMANAGEDEXECUTABLE_INTEROP_BUFFER_ALLOCATOR_H_
+#define _RUN_DOTNET_CORE_V22_SRC_UNMANAGEDEXECUTABLE_INTEROP_BUFFER_ALLOCATOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace interop_dotnet_core
+{
+    struct InteropBufferStats
+    {
+        uint64_t allocations;
+        uint64_t pool_hits;
+        uint64_t huge_page_mappings;
+        uint64_t mappings;
+        uint64_t unmappings;
+        size_t pooled_bytes;
+    };
+
+    // Allocator for the payloads handed to managed code (e.g. the double[] passed to DoWork).
+    // - Every buffer is aligned for SIMD loads (kSimdAlignment)
+    // - Large buffers are mapped directly, placed on the NUMA node of the thread that will run the managed call, and kept
+    //   in a pool on release so they are not mapped and unmapped per call
+    // - Buffers of at least kHugePageSize are rounded to whole 2 MB huge pages when huge pages are enabled; other
+    //   mappings are only rounded to kPageSize, so a 300 KB payload does not take 2 MB
+    class InteropBufferAllocator
+    {
+    public:
+        static const size_t kSimdAlignment = 64;
+        static const size_t kPageSize = 4096;
+        static const size_t kHugePageSize = 2 * 1024 * 1024;
+        static const size_t kLargeBufferThreshold = 256 * 1024;
+        static const int kCurrentNumaNode = -1;
+
+    public:
+        InteropBufferAllocator(bool use_huge_pages = true, size_t max_pooled_bytes = 256 * 1024 * 1024);
+        ~InteropBufferAllocator();
+        void* Allocate(size_t size, int numa_node = kCurrentNumaNode);
+        bool Release(void* buffer);
+        void Trim();
+        InteropBufferStats GetStats() const;
+        static int GetCurrentNumaNode();
+
+    private:
+        struct BufferInfo
+        {
+            size_t mapped_size;  // 0 for small buffers allocated from the heap
+            int numa_node;
+            bool huge_pages;
+        };
+
+    private:
+        void* MapBuffer(size_t mapped_size, int numa_node, bool* huge_pages);
+        void UnmapBuffer(void* buffer, const BufferInfo& info);
+
+    private:
+        bool _use_huge_pages;
+        size_t _max_pooled_bytes;
+        mutable std::mutex _lock;
+        std::unordered_map<void*, BufferInfo> _buffers;
+        // Released large buffers, keyed by (NUMA node, mapped size), with whether each one is backed by huge pages
+        std::map<std::pair<int, size_t>, std::vector<std::pair<void*, bool> > > _pool;
+        InteropBufferStats _stats;
+    };
+
+}  // namespace interop_dotnet_core
+
+#endif  // _RUN_DOTNET_CORE_V22_SRC_UNMANAGEDEXECUTABLE_INTEROP_BUFFER_ALLOCATOR_H_
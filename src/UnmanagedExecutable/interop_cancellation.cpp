@@ -0,0 +1,78 @@
+
+#include "./interop_cancellation.h"
+
+using interop_dotnet_core::CallControlBlock;
+using interop_dotnet_core::CallStatus;
+using interop_dotnet_core::CancellationSource;
+
+CancellationSource::CancellationSource()
+    : _has_deadline(false)
+{
+    Reset();
+}
+
+void CancellationSource::Cancel()
+{
+    _control_block.cancel_requested.store(1, std::memory_order_release);
+}
+
+void CancellationSource::SetDeadline(std::chrono::steady_clock::time_point deadline)
+{
+    _has_deadline = true;
+    _deadline = deadline;
+}
+
+void CancellationSource::SetTimeout(std::chrono::milliseconds timeout)
+{
+    SetDeadline(std::chrono::steady_clock::now() + timeout);
+}
+
+bool CancellationSource::IsCancellationRequested() const
+{
+    return _control_block.cancel_requested.load(std::memory_order_acquire) != 0;
+}
+
+CallStatus CancellationSource::GetStatus() const
+{
+    return static_cast<CallStatus>(_control_block.status);
+}
+
+CallControlBlock* CancellationSource::Prepare()
+{
+    // The managed side only knows its own clock, so the deadline is handed over as the time left right now
+    _control_block.status = interop_dotnet_core::kCallStatusRunning;
+    _control_block.timeout_ms = 0;
+    if (_has_deadline)
+    {
+        // Rounded up to whole milliseconds: rounding down would let the managed side stop before the deadline
+        auto remaining_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(_deadline - std::chrono::steady_clock::now()).count();
+        int64_t remaining_ms = (remaining_ns + 999999) / 1000000;
+        // A deadline that already passed must still expire immediately rather than mean "no deadline"
+        _control_block.timeout_ms = remaining_ms > 0 ? remaining_ms : 1;
+    }
+    return &_control_block;
+}
+
+void CancellationSource::Reset()
+{
+    _control_block.cancel_requested.store(0, std::memory_order_relaxed);
+    _control_block.status = interop_dotnet_core::kCallStatusRunning;
+    _control_block.timeout_ms = 0;
+    _has_deadline = false;
+}
+
+const char* interop_dotnet_core::GetCallStatusName(CallStatus status)
+{
+    switch (status)
+    {
+    case kCallStatusRunning:
+        return "Running";
+    case kCallStatusCompleted:
+        return "Completed";
+    case kCallStatusCancelled:
+        return "Cancelled";
+    case kCallStatusDeadlineExceeded:
+        return "DeadlineExceeded";
+    }
+    return "Unknown";
+}
@@ -0,0 +1,54 @@
+
+#ifndef _RUN_DOTNET_CORE_V22_SRC_UNMANAGEDEXECUTABLE_INTEROP_CANCELLATION_H_
+#define _RUN_DOTNET_CORE_V22_SRC_UNMANAGEDEXECUTABLE_INTEROP_CANCELLATION_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+
+namespace interop_dotnet_core
+{
+    // Must match ManagedClass.CallStatus
+    enum CallStatus
+    {
+        kCallStatusRunning = 0,
+        kCallStatusCompleted = 1,
+        kCallStatusCancelled = 2,
+        kCallStatusDeadlineExceeded = 3
+    };
+
+    // Memory shared with a running managed call (layout must match ManagedClass.CallControlBlock).
+    // The managed side polls it with plain memory reads, so requesting a cancellation never crosses into the runtime.
+    struct CallControlBlock
+    {
+        std::atomic<int32_t> cancel_requested;
+        int32_t status;        // Written by the managed side before it returns
+        int64_t timeout_ms;    // Read once when the call starts; 0 means no deadline
+    };
+    static_assert(sizeof(CallControlBlock) == 16, "CallControlBlock layout must match the managed declaration");
+
+    // Owns the control block of one managed call. Cancel() may be called from any thread while the call is running.
+    class CancellationSource
+    {
+    public:
+        CancellationSource();
+        void Cancel();
+        void SetDeadline(std::chrono::steady_clock::time_point deadline);
+        void SetTimeout(std::chrono::milliseconds timeout);
+        bool IsCancellationRequested() const;
+        CallStatus GetStatus() const;
+        CallControlBlock* Prepare();
+        void Reset();
+
+    private:
+        CallControlBlock _control_block;
+        bool _has_deadline;
+        std::chrono::steady_clock::time_point _deadline;
+    };
+
+    const char* GetCallStatusName(CallStatus status);
+
+}  // namespace interop_dotnet_core
+
+#endif  // _RUN_DOTNET_CORE_V22_SRC_UNMANAGEDEXECUTABLE_INTEROP_CANCELLATION_H_
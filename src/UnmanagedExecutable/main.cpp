@@ -3,8 +3,39 @@
 #include <string.h>
 
 #include "./dotnetcore_interop.h"
+#include "./interop_buffer_allocator.h"
+#include "./interned_strings.h"
+#include "./interop_cancellation.h"
+#include "./managed_exports.h"
+#include "./memo_cache.h"
 
+using interop_dotnet_core::CallControlBlock;
+using interop_dotnet_core::CallTraceWriter;
+using interop_dotnet_core::CancellationSource;
 using interop_dotnet_core::DotNetCoreInterop;
+using interop_dotnet_core::InternedStringTable;
+using interop_dotnet_core::InteropBufferAllocator;
+using interop_dotnet_core::MemoCache;
+using interop_dotnet_core::MemoCacheStats;
+using interop_dotnet_core::MemoizedFunction;
+using interop_dotnet_core::RegisterStringFunctionPtr;
+using interop_dotnet_core::ScopedCallRecord;
+using interop_dotnet_core::ScopedMethodProfile;
+using interop_dotnet_core::TraceArgument;
+using interop_dotnet_core::kBoolReturnExport;
+using interop_dotnet_core::kBoolReturnSignature;
+using interop_dotnet_core::kDoWorkCancellableExport;
+using interop_dotnet_core::kDoWorkCancellableSignature;
+using interop_dotnet_core::kDoWorkExport;
+using interop_dotnet_core::kDoWorkInternedExport;
+using interop_dotnet_core::kDoWorkInternedSignature;
+using interop_dotnet_core::kDoWorkSignature;
+using interop_dotnet_core::kDoWorkUtf8Export;
+using interop_dotnet_core::kDoWorkUtf8Signature;
+using interop_dotnet_core::kDoubleReturnExport;
+using interop_dotnet_core::kDoubleReturnSignature;
+using interop_dotnet_core::kRegisterJobNameExport;
+using interop_dotnet_core::kRegisterJobNameSignature;
 
 // Simple Function Declaration
 typedef bool (__stdcall *BoolReturnFunctionPtr)();
@@ -12,26 +43,63 @@ typedef double (__stdcall *GetExpirationTermPtr)();
 // Complex Function Declaration
 typedef int (*report_callback_ptr)(int progress);
 typedef char* (__stdcall *DoWorkFunctionPtr)(const char* jobName, int iterations, int dataSize, double* data, report_callback_ptr callbackFunction);
+typedef char* (__stdcall *DoWorkCancellableFunctionPtr)(const char* jobName, int iterations, int dataSize, double* data, report_callback_ptr callbackFunction, CallControlBlock* controlBlock);
+typedef char* (__stdcall *DoWorkUtf8FunctionPtr)(const char* jobName, int jobNameLength, int iterations, int dataSize, double* data, report_callback_ptr callbackFunction);
+typedef char* (__stdcall *DoWorkInternedFunctionPtr)(int jobNameHandle, int iterations, int dataSize, double* data, report_callback_ptr callbackFunction);
 
 int ReportProgressCallback(int progress);
+uint32_t RegisterRecordedMethod(DotNetCoreInterop* dotnetcore, const char* method_name, const char* signature);
 
 int main(int argc, char* argv[])
 {
-	DotNetCoreInterop dotnetcore = DotNetCoreInterop(); 
-	if (!dotnetcore.Init("C:\\Users\\roger.santos\\git\\roger\\examples\\cpp\\run_dotnet_core_v22\\src\\ManagedLibrary\\bin\\Debug\\netcoreapp2.2\\publish"))
+	// Options:
+	//   --profile                                      perf map for JIT-compiled frames and hardware counters per managed method
+	//   --record <trace_path> [payload_sample_rate]    record the managed calls for UnmanagedReplay
+	int profiling_flags = interop_dotnet_core::kProfilingNone;
+	const char* trace_path = NULL;
+	unsigned int payload_sample_rate = 1;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--profile") == 0)
+			profiling_flags = interop_dotnet_core::kProfilingPerfMap | interop_dotnet_core::kProfilingHardwareCounters;
+		else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+		{
+			trace_path = argv[++i];
+			if (i + 1 < argc && argv[i + 1][0] != '-')
+				payload_sample_rate = (unsigned int)atoi(argv[++i]);
+		}
+	}
+
+	DotNetCoreInterop dotnetcore; 
+	if (!dotnetcore.Init("C:\\Users\\roger.santos\\git\\roger\\examples\\cpp\\run_dotnet_core_v22\\src\\ManagedLibrary\\bin\\Debug\\netcoreapp2.2\\publish", profiling_flags))
 	{
 		printf("ERROR: Could not initialize .Net Core Interop.\n");
 		return -1;
 	}
+	if (!dotnetcore.LoadExportIndex("C:\\Users\\roger.santos\\git\\roger\\examples\\cpp\\run_dotnet_core_v22\\src\\ManagedLibrary\\bin\\Debug\\netcoreapp2.2\\publish\\exports.idx"))
+	{
+		printf("ERROR: Could not load the managed export index.\n");
+		return -1;
+	}
+	if (trace_path && !dotnetcore.StartRecording(trace_path, payload_sample_rate))
+	{
+		printf("ERROR: Could not start recording the managed calls.\n");
+		return -1;
+	}
 
 	// Execute Simple Function BoolReturnFunction
 	BoolReturnFunctionPtr bool_return_function_ptr;
-	if (!dotnetcore.GetFunction("ManagedLibrary, Version=1.0.0.0", "ManagedLibraryNamespace", "ManagedClass", "BoolReturn", (void**)& bool_return_function_ptr))
+	if (!dotnetcore.GetFunction(kBoolReturnExport, kBoolReturnSignature, (void**)& bool_return_function_ptr))
 	{
 		printf("ERROR: Could not get the function. (Simple Function)\n");
 		return -1;
 	}
-	bool bool_ret = bool_return_function_ptr();
+	bool bool_ret;
+	{
+		ScopedCallRecord record(dotnetcore.GetRecorder(), RegisterRecordedMethod(&dotnetcore, "BoolReturn", kBoolReturnSignature), NULL, 0);
+		ScopedMethodProfile profile(dotnetcore.GetProfiler(), "BoolReturn");
+		bool_ret = bool_return_function_ptr();
+	}
 	if (!bool_ret)
 	{
 		printf("ERROR: Got the wrong result from the delegate function.\n");
@@ -41,18 +109,36 @@ int main(int argc, char* argv[])
 	
 	// Execute Complex Function DoWork
 	DoWorkFunctionPtr do_work_function_ptr;
-	if (!dotnetcore.GetFunction("ManagedLibrary, Version=1.0.0.0", "ManagedLibraryNamespace", "ManagedClass", "DoWork", (void**)& do_work_function_ptr))
+	if (!dotnetcore.GetFunction(kDoWorkExport, kDoWorkSignature, (void**)& do_work_function_ptr))
 	{
 		printf("ERROR: Could not get the function. (Complex Function)\n");
 		return -1;
 	}
 	// Create sample data for the double[] argument of the managed method to be called
-	double data[4];
+	// Interop payloads come from the interop allocator (SIMD aligned, NUMA local and pooled when large)
+	InteropBufferAllocator buffer_allocator;
+	const int data_size = 4;
+	double* data = (double*)buffer_allocator.Allocate(data_size * sizeof(double));
+	if (!data)
+	{
+		printf("ERROR: Could not allocate the data for the complex function.\n");
+		return -1;
+	}
 	data[0] = 0;
 	data[1] = 0.25;
 	data[2] = 0.5;
 	data[3] = 0.75;
-	char* string_ret = do_work_function_ptr("Test job", 5, sizeof(data) / sizeof(double), data, ReportProgressCallback);
+	const char* job_name = "Test job";
+	int iterations = 5;
+	TraceArgument do_work_arguments[] = {{interop_dotnet_core::kTraceArgumentString, job_name, (uint32_t)strlen(job_name)},
+		{interop_dotnet_core::kTraceArgumentInt32, &iterations, sizeof(iterations)}, {interop_dotnet_core::kTraceArgumentInt32, &data_size, sizeof(data_size)},
+		{interop_dotnet_core::kTraceArgumentFloat64Array, data, data_size * sizeof(double)}, {interop_dotnet_core::kTraceArgumentCallback, NULL, 0}};
+	char* string_ret;
+	{
+		ScopedCallRecord record(dotnetcore.GetRecorder(), RegisterRecordedMethod(&dotnetcore, "DoWork", kDoWorkSignature), do_work_arguments, 5);
+		ScopedMethodProfile profile(dotnetcore.GetProfiler(), "DoWork");
+		string_ret = do_work_function_ptr(job_name, iterations, data_size, data, ReportProgressCallback);
+	}
 	if (!string_ret)
 	{
 		printf("ERROR: Got the wrong result from the complex function.\n");
@@ -65,20 +151,128 @@ int main(int argc, char* argv[])
 		printf("ERROR: Could not Release the returned string.\n");
 		return -1;
 	}
+
+	// Execute DoWork through the string fast paths: the job name as UTF-8 bytes plus length, then as an interned handle.
+	// Neither allocates a managed string for the name.
+	DoWorkUtf8FunctionPtr do_work_utf8_function_ptr;
+	RegisterStringFunctionPtr register_job_name_ptr;
+	DoWorkInternedFunctionPtr do_work_interned_function_ptr;
+	if (!dotnetcore.GetFunction(kDoWorkUtf8Export, kDoWorkUtf8Signature, (void**)& do_work_utf8_function_ptr)
+		|| !dotnetcore.GetFunction(kRegisterJobNameExport, kRegisterJobNameSignature, (void**)& register_job_name_ptr)
+		|| !dotnetcore.GetFunction(kDoWorkInternedExport, kDoWorkInternedSignature, (void**)& do_work_interned_function_ptr))
+	{
+		printf("ERROR: Could not get the function. (String Fast Path Functions)\n");
+		return -1;
+	}
+	int job_name_length = (int)strlen(job_name);
+	int fast_path_iterations = 1;
+	TraceArgument do_work_utf8_arguments[] = {{interop_dotnet_core::kTraceArgumentBytes, job_name, (uint32_t)job_name_length},
+		{interop_dotnet_core::kTraceArgumentInt32, &job_name_length, sizeof(job_name_length)},
+		{interop_dotnet_core::kTraceArgumentInt32, &fast_path_iterations, sizeof(fast_path_iterations)},
+		{interop_dotnet_core::kTraceArgumentInt32, &data_size, sizeof(data_size)},
+		{interop_dotnet_core::kTraceArgumentFloat64Array, data, data_size * sizeof(double)}, {interop_dotnet_core::kTraceArgumentCallback, NULL, 0}};
+	{
+		ScopedCallRecord record(dotnetcore.GetRecorder(), RegisterRecordedMethod(&dotnetcore, "DoWorkUtf8", kDoWorkUtf8Signature), do_work_utf8_arguments, 6);
+		ScopedMethodProfile profile(dotnetcore.GetProfiler(), "DoWorkUtf8");
+		string_ret = do_work_utf8_function_ptr(job_name, job_name_length, fast_path_iterations, data_size, data, ReportProgressCallback);
+	}
+	if (!string_ret)
+	{
+		printf("ERROR: Got the wrong result from the UTF-8 function.\n");
+		return -1;
+	}
+	printf("SUCCESS: UTF-8 Function executed properly. Return = %s\n", string_ret);
+	if (!dotnetcore.ReleaseReturn(string_ret))
+	{
+		printf("ERROR: Could not Release the returned string.\n");
+		return -1;
+	}
+	// The job name crosses the boundary once here; handles are only valid in this process, so calls by handle are not recorded
+	InternedStringTable job_names(register_job_name_ptr);
+	int32_t job_name_handle = job_names.Intern(job_name);
+	if (job_name_handle == interop_dotnet_core::kInvalidStringHandle)
+	{
+		printf("ERROR: Could not intern the job name.\n");
+		return -1;
+	}
+	{
+		ScopedMethodProfile profile(dotnetcore.GetProfiler(), "DoWorkInterned");
+		string_ret = do_work_interned_function_ptr(job_name_handle, fast_path_iterations, data_size, data, ReportProgressCallback);
+	}
+	if (!string_ret)
+	{
+		printf("ERROR: Got the wrong result from the interned function.\n");
+		return -1;
+	}
+	printf("SUCCESS: Interned Function executed properly. Return = %s\n", string_ret);
+	if (!dotnetcore.ReleaseReturn(string_ret))
+	{
+		printf("ERROR: Could not Release the returned string.\n");
+		return -1;
+	}
+
+	// Execute Complex Function DoWorkCancellable with a deadline shorter than the work, it must stop early
+	DoWorkCancellableFunctionPtr do_work_cancellable_function_ptr;
+	if (!dotnetcore.GetFunction(kDoWorkCancellableExport, kDoWorkCancellableSignature, (void**)& do_work_cancellable_function_ptr))
+	{
+		printf("ERROR: Could not get the function. (Cancellable Function)\n");
+		return -1;
+	}
+	CancellationSource cancellation;
+	int64_t timeout_ms = 1500;
+	cancellation.SetTimeout(std::chrono::milliseconds(timeout_ms));
+	TraceArgument do_work_cancellable_arguments[] = {{interop_dotnet_core::kTraceArgumentString, job_name, (uint32_t)strlen(job_name)},
+		{interop_dotnet_core::kTraceArgumentInt32, &iterations, sizeof(iterations)}, {interop_dotnet_core::kTraceArgumentInt32, &data_size, sizeof(data_size)},
+		{interop_dotnet_core::kTraceArgumentFloat64Array, data, data_size * sizeof(double)}, {interop_dotnet_core::kTraceArgumentCallback, NULL, 0},
+		{interop_dotnet_core::kTraceArgumentControlBlock, &timeout_ms, sizeof(timeout_ms)}};
+	{
+		ScopedCallRecord record(dotnetcore.GetRecorder(), RegisterRecordedMethod(&dotnetcore, "DoWorkCancellable", kDoWorkCancellableSignature),
+			do_work_cancellable_arguments, 6);
+		ScopedMethodProfile profile(dotnetcore.GetProfiler(), "DoWorkCancellable");
+		string_ret = do_work_cancellable_function_ptr(job_name, iterations, data_size, data, ReportProgressCallback, cancellation.Prepare());
+	}
+	buffer_allocator.Release(data);
+	if (string_ret || cancellation.GetStatus() != interop_dotnet_core::kCallStatusDeadlineExceeded)
+	{
+		printf("ERROR: Cancellable Function did not stop at its deadline. (status %s)\n", interop_dotnet_core::GetCallStatusName(cancellation.GetStatus()));
+		dotnetcore.ReleaseReturn(string_ret);
+		return -1;
+	}
+	printf("SUCCESS: Cancellable Function stopped at its deadline.\n");
 	// Execute Simple Function DoubleReturn
+	// DoubleReturn is pure, so it is bound through the memoization cache: only the first call reaches the runtime
+	// (and is recorded and profiled), the repeated ones are answered from native memory
+	MemoCache memo_cache(1024 * 1024);
 	GetExpirationTermPtr double_return_ptr;
-	if (!dotnetcore.GetFunction("ManagedLibrary, Version=1.0.0.0", "ManagedLibraryNamespace", "ManagedClass", "DoubleReturn", (void**)& double_return_ptr))
+	if (!dotnetcore.GetFunction(kDoubleReturnExport, kDoubleReturnSignature, (void**)& double_return_ptr))
 	{
 		printf("ERROR: Could not get the function. (double_return_ptr)\n");
 		return -1;
 	}
-	double expiration_term = double_return_ptr();
+	MemoizedFunction<double> double_return(&memo_cache, "DoubleReturn", double_return_ptr, true);
+	double expiration_term;
+	{
+		ScopedCallRecord record(dotnetcore.GetRecorder(), RegisterRecordedMethod(&dotnetcore, "DoubleReturn", kDoubleReturnSignature), NULL, 0);
+		ScopedMethodProfile profile(dotnetcore.GetProfiler(), "DoubleReturn");
+		expiration_term = double_return();
+	}
+	for (int i = 0; i < 3; i++)
+	{
+		if (double_return() != expiration_term)
+		{
+			printf("ERROR: The memoized double_return_ptr result changed.\n");
+			return -1;
+		}
+	}
 	if (expiration_term < 0)
 	{
 		printf("ERROR: Got the wrong result from the double_return_ptr function.\n");
 		return -1;
 	}
 	printf("SUCCESS: double_return_ptr Function executed properly.\n");
+	MemoCacheStats memo_stats = memo_cache.GetStats();
+	printf("Memoization cache: %llu hits, %llu misses (hit rate %.2f), %zu entries\n", (unsigned long long)memo_stats.hits,
+		(unsigned long long)memo_stats.misses, memo_stats.GetHitRate(), memo_stats.entries);
 	if (!dotnetcore.End())
 	{
 		printf("ERROR: Could not end the .Net Core Interop.\n");
@@ -88,6 +282,14 @@ int main(int argc, char* argv[])
 	return 0;
 }
 
+// Registers a ManagedClass method in the call trace when the host runs in recording mode
+uint32_t RegisterRecordedMethod(DotNetCoreInterop* dotnetcore, const char* method_name, const char* signature)
+{
+	CallTraceWriter* recorder = dotnetcore->GetRecorder();
+	if (!recorder)
+		return 0;
+	return recorder->RegisterMethod("ManagedLibrary, Version=1.0.0.0", "ManagedLibraryNamespace.ManagedClass", method_name, signature);
+}
 
 // Callback function passed to managed code to facilitate calling back into native code with status
 int ReportProgressCallback(int progress)
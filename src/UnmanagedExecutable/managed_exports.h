@@ -0,0 +1,42 @@
+
+#ifndef _RUN_DOTNET_CORE_V22_SRC_UNMANAGEDEXECUTABLE_MANAGED_EXPORTS_H_
+#define _RUN_DOTNET_CORE_V22_SRC_UNMANAGEDEXECUTABLE_MANAGED_EXPORTS_H_
+
+namespace interop_dotnet_core
+{
+    // Ids and signatures of the [NativeExport] methods of ManagedLibrary (see ManagedWorker.cs), checked against
+    // exports.idx when they are bound with DotNetCoreInterop::GetFunction
+    const char kExportIndexFileName[] = "exports.idx";
+
+    enum ManagedExportId
+    {
+        kBoolReturnExport = 1,
+        kDoubleReturnExport = 2,
+        kDoWorkExport = 3,
+        kDoWorkCancellableExport = 4,
+        kSpinWorkExport = 5,
+        kDoWorkUtf8Export = 6,
+        kRegisterJobNameExport = 7,
+        kDoWorkInternedExport = 8,
+        kJobNameHashExport = 9,
+        kJobNameHashUtf8Export = 10,
+        kJobNameHashInternedExport = 11,
+        kGetAllocatedBytesExport = 12
+    };
+
+    const char kBoolReturnSignature[] = "bool()";
+    const char kDoubleReturnSignature[] = "f64()";
+    const char kDoWorkSignature[] = "str(str,i32,i32,f64[],fn)";
+    const char kDoWorkCancellableSignature[] = "str(str,i32,i32,f64[],fn,ptr)";
+    const char kSpinWorkSignature[] = "f64(i64,ptr)";
+    const char kDoWorkUtf8Signature[] = "str(ptr,i32,i32,i32,f64[],fn)";
+    const char kRegisterJobNameSignature[] = "i32(ptr,i32)";
+    const char kDoWorkInternedSignature[] = "str(i32,i32,i32,f64[],fn)";
+    const char kJobNameHashSignature[] = "i64(str)";
+    const char kJobNameHashUtf8Signature[] = "i64(ptr,i32)";
+    const char kJobNameHashInternedSignature[] = "i64(i32)";
+    const char kGetAllocatedBytesSignature[] = "i64()";
+
+}  // namespace interop_dotnet_core
+
+#endif  // _RUN_DOTNET_CORE_V22_SRC_UNMANAGEDEXECUTABLE_MANAGED_EXPORTS_H_
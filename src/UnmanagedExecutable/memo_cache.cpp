@@ -0,0 +1,296 @@
+
+#include "./memo_cache.h"
+
+#include <stdio.h>
+#include <string.h>
+
+using interop_dotnet_core::MemoCache;
+using interop_dotnet_core::MemoCacheStats;
+using interop_dotnet_core::MemoKey;
+
+namespace
+{
+    const uint64_t kMurmurMultiplier = 0xc6a4a7935bd1e995ULL;
+    const int kMurmurShift = 47;
+
+    // Written before every serialized value so values of different types never produce the same key bytes
+    enum MemoKeyTag
+    {
+        kMemoKeyMethod = 1,
+        kMemoKeyInt,
+        kMemoKeyDouble,
+        kMemoKeyString,
+        kMemoKeyNullString,
+        kMemoKeyArray,
+        kMemoKeyBytes
+    };
+
+    // MurmurHash64A applied to one argument; the running hash is used as the seed so the argument order matters
+    uint64_t MixBytes(uint64_t hash, const void* data, size_t size)
+    {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        hash ^= size * kMurmurMultiplier;
+        while (size >= sizeof(uint64_t))
+        {
+            uint64_t block;
+            memcpy(&block, bytes, sizeof(block));
+            block *= kMurmurMultiplier;
+            block ^= block >> kMurmurShift;
+            block *= kMurmurMultiplier;
+            hash ^= block;
+            hash *= kMurmurMultiplier;
+            bytes += sizeof(uint64_t);
+            size -= sizeof(uint64_t);
+        }
+        if (size > 0)
+        {
+            uint64_t tail = 0;
+            memcpy(&tail, bytes, size);
+            hash ^= tail;
+            hash *= kMurmurMultiplier;
+        }
+        hash ^= hash >> kMurmurShift;
+        hash *= kMurmurMultiplier;
+        hash ^= hash >> kMurmurShift;
+        return hash;
+    }
+
+    uint64_t HashMethodName(const char* method_name)
+    {
+        return MixBytes(0, method_name, strlen(method_name));
+    }
+}  // namespace
+
+MemoKey::MemoKey(const char* method_name)
+    : _method_hash(HashMethodName(method_name))
+    , _hash(_method_hash)
+{
+    Append(kMemoKeyMethod, method_name, strlen(method_name));
+}
+
+MemoKey& MemoKey::Add(int value)
+{
+    return Append(kMemoKeyInt, &value, sizeof(value));
+}
+
+MemoKey& MemoKey::Add(double value)
+{
+    return Append(kMemoKeyDouble, &value, sizeof(value));
+}
+
+MemoKey& MemoKey::Add(const char* value)
+{
+    // NULL and empty strings must not produce the same key
+    if (!value)
+        return Append(kMemoKeyNullString, NULL, 0);
+    return Append(kMemoKeyString, value, strlen(value));
+}
+
+MemoKey& MemoKey::AddArray(const double* data, int data_size)
+{
+    if (!data || data_size <= 0)
+        return Append(kMemoKeyArray, NULL, 0);
+    return Append(kMemoKeyArray, data, sizeof(double) * data_size);
+}
+
+MemoKey& MemoKey::AddBytes(const void* data, size_t size)
+{
+    return Append(kMemoKeyBytes, data, size);
+}
+
+MemoKey& MemoKey::Append(unsigned char tag, const void* data, size_t size)
+{
+    // Tag and length come first, so consecutive variable-length values cannot be split differently into the same bytes
+    uint64_t length = size;
+    _bytes.push_back(static_cast<char>(tag));
+    _bytes.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    if (size > 0)
+        _bytes.append(static_cast<const char*>(data), size);
+    _hash = MixBytes(_hash, &tag, sizeof(tag));
+    _hash = MixBytes(_hash, data, size);
+    return *this;
+}
+
+uint64_t MemoKey::GetMethodHash() const
+{
+    return _method_hash;
+}
+
+uint64_t MemoKey::GetHash() const
+{
+    return _hash;
+}
+
+const std::string& MemoKey::GetBytes() const
+{
+    return _bytes;
+}
+
+double MemoCacheStats::GetHitRate() const
+{
+    uint64_t lookups = hits + misses;
+    if (lookups == 0)
+        return 0;
+    return static_cast<double>(hits) / lookups;
+}
+
+MemoCache::MemoCache(size_t capacity_bytes, unsigned int shard_count)
+    : _shard_capacity(0)
+{
+    if (shard_count == 0)
+        shard_count = 1;
+    _shard_capacity = capacity_bytes / shard_count;
+    for (unsigned int i = 0; i < shard_count; i++)
+    {
+        Shard* shard = new Shard();
+        shard->used_bytes = 0;
+        shard->hits = 0;
+        shard->misses = 0;
+        shard->insertions = 0;
+        shard->evictions = 0;
+        shard->invalidations = 0;
+        _shards.push_back(shard);
+    }
+}
+
+MemoCache::~MemoCache()
+{
+    for (size_t i = 0; i < _shards.size(); i++)
+        delete _shards[i];
+}
+
+bool MemoCache::Lookup(const MemoKey& key, std::string* value)
+{
+    Shard& shard = GetShard(key.GetHash());
+    std::lock_guard<std::mutex> guard(shard.lock);
+    auto found = shard.index.find(key.GetHash());
+    // A hash collision with another call's key is a miss, never that call's result
+    if (found == shard.index.end() || found->second->key != key.GetBytes())
+    {
+        shard.misses++;
+        return false;
+    }
+    shard.lru.splice(shard.lru.begin(), shard.lru, found->second);
+    *value = found->second->value;
+    shard.hits++;
+    return true;
+}
+
+bool MemoCache::Insert(const MemoKey& key, const void* value, size_t value_size)
+{
+    Entry entry;
+    entry.hash = key.GetHash();
+    entry.method_hash = key.GetMethodHash();
+    entry.key = key.GetBytes();
+    entry.value.assign(static_cast<const char*>(value), value_size);
+    size_t entry_size = GetEntrySize(entry);
+    if (entry_size > _shard_capacity)
+    {
+        printf("ERROR: Memoized result of %zu bytes does not fit in the cache\n", value_size);
+        return false;
+    }
+
+    Shard& shard = GetShard(entry.hash);
+    std::lock_guard<std::mutex> guard(shard.lock);
+    // Replaces the entry for the same key, or the one for another key with the same hash
+    auto found = shard.index.find(entry.hash);
+    if (found != shard.index.end())
+    {
+        shard.used_bytes -= GetEntrySize(*found->second);
+        shard.lru.erase(found->second);
+        shard.index.erase(found);
+    }
+    while (!shard.lru.empty() && shard.used_bytes + entry_size > _shard_capacity)
+    {
+        shard.used_bytes -= GetEntrySize(shard.lru.back());
+        shard.index.erase(shard.lru.back().hash);
+        shard.lru.pop_back();
+        shard.evictions++;
+    }
+    shard.lru.push_front(entry);
+    shard.index[entry.hash] = shard.lru.begin();
+    shard.used_bytes += entry_size;
+    shard.insertions++;
+    return true;
+}
+
+bool MemoCache::Invalidate(const MemoKey& key)
+{
+    Shard& shard = GetShard(key.GetHash());
+    std::lock_guard<std::mutex> guard(shard.lock);
+    auto found = shard.index.find(key.GetHash());
+    if (found == shard.index.end() || found->second->key != key.GetBytes())
+        return false;
+    shard.used_bytes -= GetEntrySize(*found->second);
+    shard.lru.erase(found->second);
+    shard.index.erase(found);
+    shard.invalidations++;
+    return true;
+}
+
+size_t MemoCache::InvalidateMethod(const char* method_name)
+{
+    uint64_t method_hash = HashMethodName(method_name);
+    size_t invalidated = 0;
+    for (size_t i = 0; i < _shards.size(); i++)
+    {
+        Shard& shard = *_shards[i];
+        std::lock_guard<std::mutex> guard(shard.lock);
+        for (auto entry = shard.lru.begin(); entry != shard.lru.end();)
+        {
+            if (entry->method_hash != method_hash)
+            {
+                ++entry;
+                continue;
+            }
+            shard.used_bytes -= GetEntrySize(*entry);
+            shard.index.erase(entry->hash);
+            entry = shard.lru.erase(entry);
+            shard.invalidations++;
+            invalidated++;
+        }
+    }
+    return invalidated;
+}
+
+void MemoCache::InvalidateAll()
+{
+    for (size_t i = 0; i < _shards.size(); i++)
+    {
+        Shard& shard = *_shards[i];
+        std::lock_guard<std::mutex> guard(shard.lock);
+        shard.invalidations += shard.lru.size();
+        shard.lru.clear();
+        shard.index.clear();
+        shard.used_bytes = 0;
+    }
+}
+
+MemoCacheStats MemoCache::GetStats() const
+{
+    MemoCacheStats stats = {};
+    for (size_t i = 0; i < _shards.size(); i++)
+    {
+        Shard& shard = *_shards[i];
+        std::lock_guard<std::mutex> guard(shard.lock);
+        stats.hits += shard.hits;
+        stats.misses += shard.misses;
+        stats.insertions += shard.insertions;
+        stats.evictions += shard.evictions;
+        stats.invalidations += shard.invalidations;
+        stats.entries += shard.lru.size();
+        stats.used_bytes += shard.used_bytes;
+    }
+    return stats;
+}
+
+MemoCache::Shard& MemoCache::GetShard(uint64_t hash) const
+{
+    // The low bits already select the bucket inside the shard map, so pick the shard from the high bits
+    return *_shards[(hash >> 32) % _shards.size()];
+}
+
+size_t MemoCache::GetEntrySize(const Entry& entry)
+{
+    return sizeof(Entry) + entry.key.size() + entry.value.size();
+}
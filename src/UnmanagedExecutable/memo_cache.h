@@ -0,0 +1,162 @@
+
+#ifndef _RUN_DOTNET_CORE_V22_SRC_UNMANAGEDEXECUTABLE_MEMO_CACHE_H_
+#define _RUN_DOTNET_CORE_V22_SRC_UNMANAGEDEXECUTABLE_MEMO_CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace interop_dotnet_core
+{
+    // Builds the cache key of a call to a pure managed function. Every argument, including the contents of the
+    // arrays passed to the managed side, is serialized with a type tag and its length. The serialized bytes are what
+    // the cache compares; the 64-bit hash of them (MurmurHash64A mixing) only selects the slot.
+    class MemoKey
+    {
+    public:
+        explicit MemoKey(const char* method_name);
+        MemoKey& Add(int value);
+        MemoKey& Add(double value);
+        MemoKey& Add(const char* value);
+        MemoKey& AddArray(const double* data, int data_size);
+        MemoKey& AddBytes(const void* data, size_t size);
+        uint64_t GetMethodHash() const;
+        uint64_t GetHash() const;
+        const std::string& GetBytes() const;
+
+    private:
+        MemoKey& Append(unsigned char tag, const void* data, size_t size);
+
+    private:
+        uint64_t _method_hash;
+        uint64_t _hash;
+        std::string _bytes;
+    };
+
+    struct MemoCacheStats
+    {
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t insertions;
+        uint64_t evictions;
+        uint64_t invalidations;
+        size_t entries;
+        size_t used_bytes;
+
+        double GetHitRate() const;
+    };
+
+    // Sharded, size-bounded LRU cache for the results of pure managed functions. Calls that hit the cache are
+    // answered from native memory and never cross into the .Net Core runtime.
+    class MemoCache
+    {
+    public:
+        MemoCache(size_t capacity_bytes, unsigned int shard_count = 16);
+        ~MemoCache();
+        bool Lookup(const MemoKey& key, std::string* value);
+        bool Insert(const MemoKey& key, const void* value, size_t value_size);
+        bool Invalidate(const MemoKey& key);
+        size_t InvalidateMethod(const char* method_name);
+        void InvalidateAll();
+        MemoCacheStats GetStats() const;
+
+        // Helpers for results that are plain values (double, bool, int...)
+        template <typename T>
+        bool Lookup(const MemoKey& key, T* value)
+        {
+            std::string bytes;
+            if (!Lookup(key, &bytes) || bytes.size() != sizeof(T))
+                return false;
+            bytes.copy(reinterpret_cast<char*>(value), sizeof(T));
+            return true;
+        }
+        template <typename T>
+        bool Insert(const MemoKey& key, const T& value)
+        {
+            return Insert(key, &value, sizeof(T));
+        }
+
+    private:
+        struct Entry
+        {
+            uint64_t hash;
+            uint64_t method_hash;
+            std::string key;
+            std::string value;
+        };
+        struct Shard
+        {
+            std::mutex lock;
+            std::list<Entry> lru;  // Most recently used first
+            std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+            size_t used_bytes;
+            uint64_t hits;
+            uint64_t misses;
+            uint64_t insertions;
+            uint64_t evictions;
+            uint64_t invalidations;
+        };
+
+    private:
+        Shard& GetShard(uint64_t hash) const;
+        static size_t GetEntrySize(const Entry& entry);
+
+    private:
+        std::vector<Shard*> _shards;
+        size_t _shard_capacity;
+    };
+
+    // Opt-in memoization of a bound managed function. When the function is marked pure, calls are keyed on the
+    // method name and the arguments and repeated calls are answered by the cache; otherwise every call goes to the
+    // runtime. Arguments must be types MemoKey::Add accepts (pointer plus size pairs cannot be keyed this way).
+    template <typename Result, typename... Args>
+    class MemoizedFunction
+    {
+    public:
+        typedef Result (__stdcall *FunctionPtr)(Args...);
+        static_assert(std::is_trivially_copyable<Result>::value, "Only plain value results can be memoized");
+
+        MemoizedFunction(MemoCache* cache, const char* method_name, FunctionPtr function, bool pure)
+            : _cache(cache)
+            , _method_name(method_name)
+            , _function(function)
+            , _pure(pure)
+        {
+        }
+
+        Result operator()(Args... args)
+        {
+            if (!_pure || !_cache)
+                return _function(args...);
+            MemoKey key(_method_name);
+            int unused[] = {0, (key.Add(args), 0)...};
+            (void)unused;
+            Result result;
+            if (_cache->Lookup(key, &result))
+                return result;
+            result = _function(args...);
+            _cache->Insert(key, result);
+            return result;
+        }
+
+        bool IsPure() const
+        {
+            return _pure;
+        }
+
+    private:
+        MemoCache* _cache;
+        const char* _method_name;
+        FunctionPtr _function;
+        bool _pure;
+    };
+
+}  // namespace interop_dotnet_core
+
+#endif  // _RUN_DOTNET_CORE_V22_SRC_UNMANAGEDEXECUTABLE_MEMO_CACHE_H_
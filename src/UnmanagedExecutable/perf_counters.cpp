@@ -0,0 +1,177 @@
+
+#include "./perf_counters.h"
+
+#include <stdio.h>
+#include <string.h>
+
+using interop_dotnet_core::MethodProfiler;
+using interop_dotnet_core::PerfCounterGroup;
+using interop_dotnet_core::PerfCounterValues;
+using interop_dotnet_core::ScopedMethodProfile;
+
+#if LINUX
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    // perf_event_open counters belong to a thread, so every thread that runs profiled calls opens its own group
+    PerfCounterGroup* GetThreadCounters()
+    {
+        thread_local PerfCounterGroup counters;
+        thread_local bool opened = false;
+        if (!opened)
+        {
+            opened = true;
+            counters.Open();
+        }
+        return counters.IsOpen() ? &counters : NULL;
+    }
+}  // namespace
+
+PerfCounterGroup::PerfCounterGroup()
+{
+    for (int i = 0; i < kCounterCount; i++)
+        _fds[i] = -1;
+}
+
+PerfCounterGroup::~PerfCounterGroup()
+{
+#if LINUX
+    for (int i = 0; i < kCounterCount; i++)
+    {
+        if (_fds[i] >= 0)
+            close(_fds[i]);
+    }
+#endif
+}
+
+bool PerfCounterGroup::Open()
+{
+#if LINUX
+    const uint64_t configs[kCounterCount] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+    for (int i = 0; i < kCounterCount; i++)
+    {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[i];
+        attr.disabled = i == 0 ? 1 : 0;  // The whole group is enabled through its leader
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        _fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, i == 0 ? -1 : _fds[0], 0));
+        if (_fds[i] < 0)
+        {
+            printf("WARNING: Hardware counters are not available (perf_event_open failed for counter %d)\n", i);
+            for (int j = 0; j < i; j++)
+            {
+                close(_fds[j]);
+                _fds[j] = -1;
+            }
+            _fds[i] = -1;
+            return false;
+        }
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool PerfCounterGroup::IsOpen() const
+{
+    return _fds[0] >= 0;
+}
+
+void PerfCounterGroup::Start()
+{
+#if LINUX
+    if (!IsOpen())
+        return;
+    ioctl(_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+bool PerfCounterGroup::Stop(PerfCounterValues* values)
+{
+    memset(values, 0, sizeof(*values));
+#if LINUX
+    if (!IsOpen())
+        return false;
+    ioctl(_fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    // PERF_FORMAT_GROUP layout: number of counters followed by their values in creation order
+    uint64_t group[1 + kCounterCount];
+    if (read(_fds[0], group, sizeof(group)) != static_cast<ssize_t>(sizeof(group)) || group[0] != kCounterCount)
+        return false;
+    values->cycles = group[1 + kCycles];
+    values->instructions = group[1 + kInstructions];
+    values->cache_misses = group[1 + kCacheMisses];
+    values->branch_misses = group[1 + kBranchMisses];
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool MethodProfiler::IsSupported()
+{
+    return GetThreadCounters() != NULL;
+}
+
+void MethodProfiler::Record(const char* method_name, const PerfCounterValues& values, std::chrono::steady_clock::duration elapsed)
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    MethodCounters& method = _methods[method_name];
+    method.calls++;
+    method.elapsed_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    method.totals.cycles += values.cycles;
+    method.totals.instructions += values.instructions;
+    method.totals.cache_misses += values.cache_misses;
+    method.totals.branch_misses += values.branch_misses;
+}
+
+void MethodProfiler::PrintReport() const
+{
+    std::lock_guard<std::mutex> guard(_lock);
+    printf("%-24s %8s %14s %14s %14s %6s %16s %16s\n", "Method", "Calls", "ns/call", "cycles/call", "instr/call", "IPC",
+        "cache miss/call", "branch miss/call");
+    for (auto method = _methods.begin(); method != _methods.end(); ++method)
+    {
+        const MethodCounters& counters = method->second;
+        double calls = static_cast<double>(counters.calls);
+        double ipc = counters.totals.cycles ? static_cast<double>(counters.totals.instructions) / counters.totals.cycles : 0;
+        printf("%-24s %8llu %14.0f %14.0f %14.0f %6.2f %16.1f %16.1f\n", method->first.c_str(), (unsigned long long)counters.calls,
+            counters.elapsed_ns / calls, counters.totals.cycles / calls, counters.totals.instructions / calls, ipc,
+            counters.totals.cache_misses / calls, counters.totals.branch_misses / calls);
+    }
+}
+
+ScopedMethodProfile::ScopedMethodProfile(MethodProfiler* profiler, const char* method_name)
+    : _profiler(profiler)
+    , _method_name(method_name)
+    , _counters(profiler ? GetThreadCounters() : NULL)
+{
+    // Profiled calls must not be nested on one thread: starting the group resets the outer call's counts
+    _start = std::chrono::steady_clock::now();
+    if (_counters)
+        _counters->Start();
+}
+
+ScopedMethodProfile::~ScopedMethodProfile()
+{
+    if (!_profiler)
+        return;
+    PerfCounterValues values;
+    if (_counters)
+        _counters->Stop(&values);
+    else
+        memset(&values, 0, sizeof(values));
+    _profiler->Record(_method_name, values, std::chrono::steady_clock::now() - _start);
+}
@@ -0,0 +1,83 @@
+
+#ifndef _RUN_DOTNET_CORE_V22_SRC_UNMANAGEDEXECUTABLE_PERF_COUNTERS_H_
+#define _RUN_DOTNET_CORE_V22_SRC_UNMANAGEDEXECUTABLE_PERF_COUNTERS_H_
+
+#include <stdint.h>
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+
+namespace interop_dotnet_core
+{
+    struct PerfCounterValues
+    {
+        uint64_t cycles;
+        uint64_t instructions;
+        uint64_t cache_misses;
+        uint64_t branch_misses;
+    };
+
+    // Hardware counters (perf_event_open) of the calling thread, scheduled together as one group.
+    // Only available on Linux when perf_event_paranoid allows user space counting.
+    class PerfCounterGroup
+    {
+    public:
+        PerfCounterGroup();
+        ~PerfCounterGroup();
+        bool Open();
+        bool IsOpen() const;
+        void Start();
+        bool Stop(PerfCounterValues* values);
+
+    private:
+        enum
+        {
+            kCycles,
+            kInstructions,
+            kCacheMisses,
+            kBranchMisses,
+            kCounterCount
+        };
+        int _fds[kCounterCount];
+    };
+
+    // Aggregates the counters of the managed calls wrapped in ScopedMethodProfile, per method
+    class MethodProfiler
+    {
+    public:
+        static bool IsSupported();
+        void Record(const char* method_name, const PerfCounterValues& values, std::chrono::steady_clock::duration elapsed);
+        void PrintReport() const;
+
+    private:
+        struct MethodCounters
+        {
+            uint64_t calls;
+            uint64_t elapsed_ns;
+            PerfCounterValues totals;
+        };
+
+    private:
+        mutable std::mutex _lock;
+        std::map<std::string, MethodCounters> _methods;
+    };
+
+    // Counts one managed call on the calling thread and adds it to the profiler (no-op when profiler is NULL)
+    class ScopedMethodProfile
+    {
+    public:
+        ScopedMethodProfile(MethodProfiler* profiler, const char* method_name);
+        ~ScopedMethodProfile();
+
+    private:
+        MethodProfiler* _profiler;
+        const char* _method_name;
+        PerfCounterGroup* _counters;
+        std::chrono::steady_clock::time_point _start;
+    };
+
+}  // namespace interop_dotnet_core
+
+#endif  // _RUN_DOTNET_CORE_V22_SRC_UNMANAGEDEXECUTABLE_PERF_COUNTERS_H_
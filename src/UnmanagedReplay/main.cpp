@@ -0,0 +1,472 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../UnmanagedExecutable/call_trace.h"
+#include "../UnmanagedExecutable/dotnetcore_interop.h"
+#include "../UnmanagedExecutable/interop_cancellation.h"
+
+using interop_dotnet_core::CallTraceReader;
+using interop_dotnet_core::CancellationSource;
+using interop_dotnet_core::DotNetCoreInterop;
+using interop_dotnet_core::TraceArgumentRecord;
+using interop_dotnet_core::TraceCallRecord;
+using interop_dotnet_core::TraceMethod;
+
+// Calls are rebuilt from the argument kinds recorded in the trace. Each argument is passed as one of these classes,
+// which is what decides the register or stack slot it travels in.
+const size_t kMaxReplayArguments = 6;
+const double kLateStartThresholdUs = 1000;
+
+enum ReplayWordClass
+{
+	kReplayWordPointer,  // Pointers and 32-bit integers
+	kReplayWordInt64,
+	kReplayWordFloat64
+};
+
+// Doubles come back in a floating point register and strings must be released, everything else is ignored
+enum ReplayReturnKind
+{
+	kReplayReturnUnsupported,
+	kReplayReturnInteger,
+	kReplayReturnFloat64,
+	kReplayReturnString
+};
+
+struct ReplayMethod
+{
+	std::string name;
+	ReplayReturnKind return_kind;
+	void* function;
+};
+
+struct ReplayArgument
+{
+	uint8_t kind;
+	int64_t integer;             // Int32, Int64 and the timeout of a control block (-1 when no block was passed)
+	double real;                 // Float64
+	std::string bytes;           // String (NUL terminated) and Bytes
+	std::vector<double> array;   // Float64Array
+};
+
+// Arguments are decoded before the replay starts so the measured latency only covers the managed call
+struct ReplayCall
+{
+	uint32_t method_id;
+	uint64_t timestamp_ns;
+	uint64_t recorded_latency_ns;
+	std::vector<ReplayArgument> arguments;
+};
+
+struct ReplayResult
+{
+	uint32_t method_id;
+	double latency_us;      // From the time the call was scheduled, so waiting for a free thread is included
+	double service_us;      // From the time the call actually started
+	double start_delay_us;
+};
+
+struct ReplayWord
+{
+	ReplayWordClass word_class;
+	intptr_t pointer;
+	int64_t int64;
+	double float64;
+};
+
+// Only the member of the word's class is set
+template <typename T>
+T GetReplayWord(const ReplayWord& word)
+{
+	if (word.word_class == kReplayWordFloat64)
+		return static_cast<T>(word.float64);
+	if (word.word_class == kReplayWordInt64)
+		return static_cast<T>(word.int64);
+	return static_cast<T>(word.pointer);
+}
+
+// Builds the function pointer type one argument class at a time, then calls it with the words in order
+template <typename Result, typename... Params>
+struct ReplayInvoker
+{
+	template <size_t... Indexes>
+	static Result Call(void* function, const ReplayWord* words, std::index_sequence<Indexes...>)
+	{
+		typedef Result (__stdcall *FunctionPtr)(Params...);
+		return ((FunctionPtr)function)(GetReplayWord<Params>(words[Indexes])...);
+	}
+
+	static Result Invoke(void* function, const ReplayWord* words, size_t count)
+	{
+		if (count == sizeof...(Params))
+			return Call(function, words, std::index_sequence_for<Params...>());
+		return Extend(function, words, count, std::integral_constant<bool, (sizeof...(Params) < kMaxReplayArguments)>());
+	}
+
+	static Result Extend(void* function, const ReplayWord* words, size_t count, std::true_type)
+	{
+		switch (words[sizeof...(Params)].word_class)
+		{
+		case kReplayWordFloat64:
+			return ReplayInvoker<Result, Params..., double>::Invoke(function, words, count);
+		case kReplayWordInt64:
+			return ReplayInvoker<Result, Params..., int64_t>::Invoke(function, words, count);
+		default:
+			return ReplayInvoker<Result, Params..., intptr_t>::Invoke(function, words, count);
+		}
+	}
+
+	static Result Extend(void*, const ReplayWord*, size_t, std::false_type)
+	{
+		return Result();
+	}
+};
+
+int ReplayProgressCallback(int progress);
+bool BindMethods(DotNetCoreInterop* dotnetcore, const std::map<uint32_t, TraceMethod>& trace_methods, std::map<uint32_t, ReplayMethod>* methods);
+ReplayReturnKind GetReturnKind(const std::string& signature);
+bool DecodeCall(const TraceCallRecord& record, ReplayCall* call);
+void BuildWords(const ReplayCall& call, CancellationSource* cancellation, ReplayWord* words);
+void ReplayThread(DotNetCoreInterop* dotnetcore, const std::map<uint32_t, ReplayMethod>* methods, const std::vector<ReplayCall>* calls,
+	std::atomic<size_t>* next_call, double speed, std::chrono::steady_clock::time_point start, std::vector<ReplayResult>* results);
+void PrintLatencies(const char* name, std::vector<double>* latencies_us);
+
+void PrintUsage()
+{
+	printf("Usage: UnmanagedReplay <dotnet_libs_dir> <trace_path> [--speed original|max|<factor>] [--threads N]\n");
+	printf("  Every recorded method is replayed from the argument kinds stored in the trace. Calls with more than %zu\n", kMaxReplayArguments);
+	printf("  arguments and methods returning float (f32) are skipped.\n");
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		PrintUsage();
+		return -1;
+	}
+	// speed: 1 replays at the recorded pace, 2 twice as fast... and 0 issues calls back to back
+	double speed = 1;
+	int thread_count = 1;
+	for (int i = 3; i + 1 < argc; i += 2)
+	{
+		if (strcmp(argv[i], "--speed") == 0)
+			speed = strcmp(argv[i + 1], "max") == 0 ? 0 : strcmp(argv[i + 1], "original") == 0 ? 1 : atof(argv[i + 1]);
+		else if (strcmp(argv[i], "--threads") == 0)
+			thread_count = atoi(argv[i + 1]);
+		else
+		{
+			PrintUsage();
+			return -1;
+		}
+	}
+	if (speed < 0 || thread_count <= 0)
+	{
+		printf("ERROR: Speed must not be negative and threads must be positive\n");
+		return -1;
+	}
+
+	CallTraceReader trace;
+	if (!trace.Load(argv[2]))
+		return -1;
+	DotNetCoreInterop dotnetcore;
+	if (!dotnetcore.Init(argv[1]))
+	{
+		printf("ERROR: Could not initialize .Net Core Interop.\n");
+		return -1;
+	}
+	std::map<uint32_t, ReplayMethod> methods;
+	if (!BindMethods(&dotnetcore, trace.GetMethods(), &methods))
+		return -1;
+
+	std::vector<ReplayCall> calls;
+	size_t skipped_calls = 0;
+	for (size_t i = 0; i < trace.GetCalls().size(); i++)
+	{
+		const TraceCallRecord& record = trace.GetCalls()[i];
+		auto method = methods.find(record.method_id);
+		ReplayCall call;
+		if (method == methods.end() || method->second.return_kind == kReplayReturnUnsupported || !DecodeCall(record, &call))
+		{
+			skipped_calls++;
+			continue;
+		}
+		calls.push_back(call);
+	}
+	printf("Replaying %zu calls (%zu skipped) on %d threads at %s speed\n", calls.size(), skipped_calls, thread_count,
+		speed == 0 ? "max" : std::to_string(speed).c_str());
+
+	// Calls are handed out in trace order to whichever thread is free next
+	std::vector<std::vector<ReplayResult> > results(thread_count);
+	std::vector<std::thread> threads;
+	std::atomic<size_t> next_call(0);
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < thread_count; i++)
+		threads.push_back(std::thread(ReplayThread, &dotnetcore, &methods, &calls, &next_call, speed, start, &results[i]));
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+	double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	// Report throughput, then the replayed latency distribution next to the recorded one for each method
+	printf("Replayed %zu calls in %.3f s: %.1f calls/s\n", calls.size(), elapsed_s, calls.size() / elapsed_s);
+	std::vector<double> all_latencies;
+	std::vector<double> all_service_times;
+	std::map<uint32_t, std::vector<double> > method_latencies;
+	std::map<uint32_t, std::vector<double> > recorded_latencies;
+	size_t late_calls = 0;
+	double max_start_delay_us = 0;
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		for (size_t j = 0; j < results[i].size(); j++)
+		{
+			const ReplayResult& result = results[i][j];
+			all_latencies.push_back(result.latency_us);
+			all_service_times.push_back(result.service_us);
+			method_latencies[result.method_id].push_back(result.latency_us);
+			if (result.start_delay_us > kLateStartThresholdUs)
+				late_calls++;
+			max_start_delay_us = std::max(max_start_delay_us, result.start_delay_us);
+		}
+	}
+	if (speed > 0)
+		printf("%zu calls started more than %.0f ms late (max delay %.1f ms)\n", late_calls, kLateStartThresholdUs / 1000, max_start_delay_us / 1000);
+	for (size_t i = 0; i < calls.size(); i++)
+		recorded_latencies[calls[i].method_id].push_back(calls[i].recorded_latency_ns / 1000.0);
+	PrintLatencies("all (replayed)", &all_latencies);
+	PrintLatencies("all (service time)", &all_service_times);
+	for (auto method = method_latencies.begin(); method != method_latencies.end(); ++method)
+	{
+		std::string name = methods[method->first].name;
+		PrintLatencies((name + " (replayed)").c_str(), &method->second);
+		PrintLatencies((name + " (recorded)").c_str(), &recorded_latencies[method->first]);
+	}
+
+	if (!dotnetcore.End())
+	{
+		printf("ERROR: Could not end the .Net Core Interop.\n");
+		return -1;
+	}
+	return 0;
+}
+
+bool BindMethods(DotNetCoreInterop* dotnetcore, const std::map<uint32_t, TraceMethod>& trace_methods, std::map<uint32_t, ReplayMethod>* methods)
+{
+	for (auto trace_method = trace_methods.begin(); trace_method != trace_methods.end(); ++trace_method)
+	{
+		const TraceMethod& identity = trace_method->second;
+		ReplayMethod method;
+		method.name = identity.method_name;
+		method.return_kind = GetReturnKind(identity.signature);
+		method.function = NULL;
+		if (method.return_kind == kReplayReturnUnsupported)
+		{
+			printf("WARNING: %s (%s) cannot be replayed, its calls are skipped\n", identity.method_name.c_str(), identity.signature.c_str());
+			(*methods)[trace_method->first] = method;
+			continue;
+		}
+
+		// The trace records the full type name, GetFunction takes the namespace and the class separately
+		size_t separator = identity.type_name.rfind('.');
+		std::string namespace_name = separator == std::string::npos ? "" : identity.type_name.substr(0, separator);
+		std::string class_name = separator == std::string::npos ? identity.type_name : identity.type_name.substr(separator + 1);
+		if (!dotnetcore->GetFunction(identity.assembly_name.c_str(), namespace_name.c_str(), class_name.c_str(), identity.method_name.c_str(), &method.function))
+		{
+			printf("ERROR: Could not get the function %s.%s\n", identity.type_name.c_str(), identity.method_name.c_str());
+			return false;
+		}
+		(*methods)[trace_method->first] = method;
+	}
+	return true;
+}
+
+ReplayReturnKind GetReturnKind(const std::string& signature)
+{
+	size_t parameters = signature.find('(');
+	if (parameters == std::string::npos)
+		return kReplayReturnUnsupported;
+	std::string return_type = signature.substr(0, parameters);
+	if (return_type == "f64")
+		return kReplayReturnFloat64;
+	if (return_type == "str")
+		return kReplayReturnString;
+	if (return_type == "f32")
+		return kReplayReturnUnsupported;
+	return kReplayReturnInteger;
+}
+
+bool DecodeCall(const TraceCallRecord& record, ReplayCall* call)
+{
+	// Payloads that were not sampled are replaced by placeholders of the recorded size
+	call->method_id = record.method_id;
+	call->timestamp_ns = record.timestamp_ns;
+	call->recorded_latency_ns = record.latency_ns;
+	if (record.arguments.size() > kMaxReplayArguments)
+		return false;
+	call->arguments.resize(record.arguments.size());
+	for (size_t i = 0; i < record.arguments.size(); i++)
+	{
+		const TraceArgumentRecord& recorded = record.arguments[i];
+		ReplayArgument& argument = call->arguments[i];
+		argument.kind = recorded.kind;
+		argument.integer = 0;
+		argument.real = 0;
+		switch (recorded.kind)
+		{
+		case interop_dotnet_core::kTraceArgumentInt32:
+		{
+			int32_t value = 0;
+			if (recorded.has_payload && recorded.payload.size() == sizeof(value))
+				memcpy(&value, recorded.payload.data(), sizeof(value));
+			argument.integer = value;
+			break;
+		}
+		case interop_dotnet_core::kTraceArgumentInt64:
+			if (recorded.has_payload && recorded.payload.size() == sizeof(argument.integer))
+				memcpy(&argument.integer, recorded.payload.data(), sizeof(argument.integer));
+			break;
+		case interop_dotnet_core::kTraceArgumentControlBlock:
+			argument.integer = -1;
+			if (recorded.has_payload && recorded.payload.size() == sizeof(argument.integer))
+				memcpy(&argument.integer, recorded.payload.data(), sizeof(argument.integer));
+			break;
+		case interop_dotnet_core::kTraceArgumentFloat64:
+			if (recorded.has_payload && recorded.payload.size() == sizeof(argument.real))
+				memcpy(&argument.real, recorded.payload.data(), sizeof(argument.real));
+			break;
+		case interop_dotnet_core::kTraceArgumentString:
+			argument.bytes = recorded.has_payload ? recorded.payload : std::string(recorded.size, 'x');
+			break;
+		case interop_dotnet_core::kTraceArgumentBytes:
+			argument.bytes = recorded.has_payload ? recorded.payload : std::string(recorded.size, '\0');
+			break;
+		case interop_dotnet_core::kTraceArgumentFloat64Array:
+			argument.array.resize(recorded.size / sizeof(double));
+			if (recorded.has_payload && !argument.array.empty())
+				memcpy(&argument.array[0], recorded.payload.data(), argument.array.size() * sizeof(double));
+			break;
+		case interop_dotnet_core::kTraceArgumentCallback:
+			break;
+		default:
+			return false;
+		}
+	}
+	return true;
+}
+
+void BuildWords(const ReplayCall& call, CancellationSource* cancellation, ReplayWord* words)
+{
+	for (size_t i = 0; i < call.arguments.size(); i++)
+	{
+		const ReplayArgument& argument = call.arguments[i];
+		ReplayWord& word = words[i];
+		word.word_class = kReplayWordPointer;
+		word.pointer = 0;
+		word.int64 = 0;
+		word.float64 = 0;
+		switch (argument.kind)
+		{
+		case interop_dotnet_core::kTraceArgumentInt32:
+			word.pointer = static_cast<intptr_t>(argument.integer);
+			break;
+		case interop_dotnet_core::kTraceArgumentInt64:
+			word.word_class = kReplayWordInt64;
+			word.int64 = argument.integer;
+			break;
+		case interop_dotnet_core::kTraceArgumentFloat64:
+			word.word_class = kReplayWordFloat64;
+			word.float64 = argument.real;
+			break;
+		case interop_dotnet_core::kTraceArgumentString:
+		case interop_dotnet_core::kTraceArgumentBytes:
+			word.pointer = reinterpret_cast<intptr_t>(argument.bytes.c_str());
+			break;
+		case interop_dotnet_core::kTraceArgumentFloat64Array:
+			word.pointer = argument.array.empty() ? 0 : reinterpret_cast<intptr_t>(&argument.array[0]);
+			break;
+		case interop_dotnet_core::kTraceArgumentCallback:
+			word.pointer = reinterpret_cast<intptr_t>(&ReplayProgressCallback);
+			break;
+		case interop_dotnet_core::kTraceArgumentControlBlock:
+			if (argument.integer < 0)
+				break;
+			if (argument.integer > 0)
+				cancellation->SetTimeout(std::chrono::milliseconds(argument.integer));
+			word.pointer = reinterpret_cast<intptr_t>(cancellation->Prepare());
+			break;
+		}
+	}
+}
+
+void ReplayThread(DotNetCoreInterop* dotnetcore, const std::map<uint32_t, ReplayMethod>* methods, const std::vector<ReplayCall>* calls,
+	std::atomic<size_t>* next_call, double speed, std::chrono::steady_clock::time_point start, std::vector<ReplayResult>* results)
+{
+	for (size_t i = next_call->fetch_add(1); i < calls->size(); i = next_call->fetch_add(1))
+	{
+		// When every thread is busy the call starts late; the wait counts in its latency as it would for the caller
+		const ReplayCall& call = (*calls)[i];
+		auto scheduled = start + std::chrono::nanoseconds((uint64_t)(speed > 0 ? call.timestamp_ns / speed : 0));
+		if (speed > 0)
+			std::this_thread::sleep_until(scheduled);
+
+		const ReplayMethod& method = methods->at(call.method_id);
+		CancellationSource cancellation;
+		ReplayWord words[kMaxReplayArguments];
+		BuildWords(call, &cancellation, words);
+		char* string_ret = NULL;
+		auto call_start = std::chrono::steady_clock::now();
+		if (speed == 0)
+			scheduled = call_start;
+		switch (method.return_kind)
+		{
+		case kReplayReturnFloat64:
+			ReplayInvoker<double>::Invoke(method.function, words, call.arguments.size());
+			break;
+		case kReplayReturnString:
+			string_ret = reinterpret_cast<char*>(ReplayInvoker<intptr_t>::Invoke(method.function, words, call.arguments.size()));
+			break;
+		case kReplayReturnInteger:
+			ReplayInvoker<intptr_t>::Invoke(method.function, words, call.arguments.size());
+			break;
+		case kReplayReturnUnsupported:
+			break;
+		}
+		auto call_end = std::chrono::steady_clock::now();
+		ReplayResult result;
+		result.method_id = call.method_id;
+		result.latency_us = std::chrono::duration<double, std::micro>(call_end - scheduled).count();
+		result.service_us = std::chrono::duration<double, std::micro>(call_end - call_start).count();
+		result.start_delay_us = std::chrono::duration<double, std::micro>(call_start - scheduled).count();
+		results->push_back(result);
+		if (string_ret)
+			dotnetcore->ReleaseReturn(string_ret);
+	}
+}
+
+void PrintLatencies(const char* name, std::vector<double>* latencies_us)
+{
+	if (latencies_us->empty())
+		return;
+	std::sort(latencies_us->begin(), latencies_us->end());
+	size_t count = latencies_us->size();
+	printf("%-32s %8zu calls  p50 %10.1f us  p90 %10.1f us  p99 %10.1f us  p99.9 %10.1f us  max %10.1f us\n", name, count,
+		(*latencies_us)[count / 2], (*latencies_us)[count * 90 / 100], (*latencies_us)[count * 99 / 100], (*latencies_us)[count * 999 / 1000],
+		latencies_us->back());
+}
+
+// Progress callback handed to the replayed calls; replays must not flood the console
+int ReplayProgressCallback(int progress)
+{
+	return -progress;
+}